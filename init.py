@@ -33,10 +33,15 @@ for L in arr:
                 print(job)
 
 
-for str in ["crystal", "density", "demixed"]:
+for str in ["crystal", "density", "demixed", "series", "summary", "histogram", "clusters", "stats", "tempering"]:
         files = glob.glob(os.path.join("/home/tashfiq/wr_lattice/data/sampling/" + str, "*"))
         for f in files:
             if os.path.isfile(f): 
                 os.remove(f)
 
+# stale checkpoints would otherwise be resumed by the new jobs
+for f in glob.glob("/home/tashfiq/wr_lattice/data/checkpoints/*"):
+    if os.path.isfile(f):
+        os.remove(f)
+
 print(arr)
\ No newline at end of file
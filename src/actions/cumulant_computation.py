@@ -6,6 +6,7 @@ import matplotlib.pyplot as plt
 import math
 from scipy.stats import bootstrap
 from pymbar import timeseries 
+from timeseries_io import load_observable, load_summary
 
 def output_cumulant(job, cumulant):
     with open(job.fn("cumulant.txt"), "w") as file:
@@ -136,18 +137,12 @@ if __name__ == '__main__':
     param = "demixed"
     run = 3
 
-    data = []
+    data = load_observable(param, L, M, z, lat, run)
 
-    filename = param + "_L" + str(L) + "_M" + str(M) + "_z" + f"{z:.3f}".replace('.', '-') + "_" + lat + "_run" + str(run) + ".txt"
-    pathname = "/home/tashfiq/wr_lattice/data/sampling/" + param + "/" + filename
-
-    with open(pathname, "r") as f:                  # get equilibriated system's nodes from main.cpp file, to be handled by NetworkX to display network graph
-        for x in f:
-            data.append(float(x))
-
-    data = np.array(data)
-
-    data = data[5000:]
+    # burn-in chosen by the simulation (fixed or MSER-detected), 5000 for runs without a summary
+    summary = load_summary(L, M, z, lat, run)
+    burn_in = summary["burn_in"] if summary is not None else 5000
+    data = data[burn_in:]
 
     n_resamples = 1500
     n = len(data)
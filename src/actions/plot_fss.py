@@ -0,0 +1,62 @@
+import argparse
+import json
+import os
+import numpy as np
+import matplotlib.pyplot as plt
+
+# Figures of the finite-size-scaling analysis written by src/analysis/fss.cpp:
+# finite-size_scaling.png, zc_distribution.png and intersection_distribution_L_<L>.png.
+
+
+def load_fss(M, lat, observable, sampling_dir):
+    tag = f"M{M}_{lat}_{observable}"
+    with open(os.path.join(sampling_dir, "fss", f"fss_{tag}.json")) as f:
+        fss = json.load(f)
+    crossings = np.genfromtxt(os.path.join(sampling_dir, "fss", f"crossings_{tag}.csv"), delimiter=",", names=True)
+    return fss, crossings
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--M", type=int, required=True, help="Number of species in system")
+    parser.add_argument("--lat", type=str, required=True, help="Type of Lattice")
+    parser.add_argument("--observable", type=str, default="demixed")
+    parser.add_argument("--dir", type=str, default="data/sampling", help="Sampling directory")
+    args = parser.parse_args()
+
+    fss, crossings = load_fss(args.M, args.lat, args.observable, args.dir)
+
+    L_finite = np.array([c["L"] for c in fss["crossings"]])
+    points = np.array([c["z"]["mean"] for c in fss["crossings"]])
+    errors = np.array([c["z"]["error"] for c in fss["crossings"]])
+
+    plt.errorbar(1/L_finite, points, yerr=errors, fmt='o', label='Data')
+
+    if fss["z_c_of_mean_crossings"] is not None:
+        x_smooth = np.linspace(1e-6, max(1/L_finite), 200)
+        plt.plot(x_smooth, fss["z_c_of_mean_crossings"] + fss["A_of_mean_crossings"] * x_smooth, 'r-', label='Fitted Curve')
+
+    plt.xlabel(r'$L^{-1}$')
+    plt.ylabel(r'Crossing Point $z_c(L)$')
+    plt.legend()
+    plt.savefig('finite-size_scaling.png', dpi=300, bbox_inches='tight')
+
+    z_c = crossings["z_c"][np.isfinite(crossings["z_c"])]
+    if len(z_c) > 0:
+        plt.figure()
+        plt.hist(z_c, bins=40, color='skyblue', edgecolor='black')
+        plt.title('Distribution of Critical Points from Bootstrap Samples')
+        plt.xlabel('Critical Point $z_c$')
+        plt.ylabel('Frequency')
+        plt.savefig('zc_distribution.png', dpi=300, bbox_inches='tight')
+
+    for L in L_finite:
+        plt.figure()
+        plt.hist(crossings[f"z_L{L}"], bins=40, color='skyblue', edgecolor='black')
+        plt.title('Distribution of Intersection Points for L={}'.format(L))
+        plt.xlabel('Intersection Point $z_c(L)$')
+        plt.ylabel('Frequency')
+        plt.savefig('intersection_distribution_L_{}.png'.format(L), dpi=300, bbox_inches='tight')
+
+    print(f"Critical point: {fss['z_c']['mean']} ± {fss['z_c']['error']}")
@@ -6,6 +6,7 @@ from scipy.optimize import curve_fit
 import matplotlib.pyplot as plt
 from scipy.interpolate import CubicSpline
 import glob
+from timeseries_io import load_observable, load_summary
 
 
 def binder_cumulant(data):
@@ -52,19 +53,21 @@ if __name__ == '__main__':
         lat = job.sp.lat
         run = job.sp.run
 
-        data = []
+        # per-run cumulant accumulated by main.cpp (its own --burn-in) if available,
+        # otherwise recomputed from the raw time series
+        summary = load_summary(L, M, z, lat, run)
 
-        filename = param + "_L" + str(L) + "_M" + str(M) + "_z" + f"{z:.3f}".replace('.', '-') + "_" + lat + "_run" + str(run) + ".txt"
-        pathname = "/home/tashfiq/wr_lattice/data/sampling/" + param + "/" + filename
+        if summary is not None and summary["observables"][param]["binder"] is not None:
+            U_L = summary["observables"][param]["binder"]
+        else:
+            data = load_observable(param, L, M, z, lat, run)
 
-        if not os.path.exists(pathname):
-            continue
-
-        data = np.loadtxt(pathname)
+            if data is None:
+                continue
 
-        data = data[burn_in:]
+            data = data[burn_in:]
 
-        U_L = binder_cumulant(data)
+            U_L = binder_cumulant(data)
 
         container.setdefault(L, {}).setdefault(z, {})[run] = U_L
 
@@ -11,7 +11,8 @@ def run_wr(executable: str, L: int, M: int, z: float, lat: str, run: int) -> str
         '--M', str(M),
         '--z', str(z),
         '--lat', lat,
-        '--run', str(run)
+        '--run', str(run),
+        '--resume'      # continue from data/checkpoints if an earlier job was cut off
     ]
     print(f"Simulation parameters: L = {L}, M = {M}, z = {z}, lat = {lat}, run = {run}")
 
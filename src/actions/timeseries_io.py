@@ -0,0 +1,79 @@
+import json
+import os
+import struct
+import numpy as np
+
+# Reader for the binary time series written by main.cpp (see src/sim/timeseries.h):
+# an 80-byte header, 16-byte field names, then float32/float64 records with one value per field.
+
+HEADER_FORMAT = "<8sIIiid16siIQIIQ"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+FIELD_BYTES = 16
+
+SAMPLING_DIR = "/home/tashfiq/wr_lattice/data/sampling"
+
+
+def read_series(path):
+    """Returns (meta, fields): the header as a dict and {field name: 1D array}."""
+    with open(path, "rb") as f:
+        raw = f.read(HEADER_SIZE)
+        (magic, version, header_bytes, L, M, z, lat, run, stride, seed,
+         n_fields, value_bytes, n_records) = struct.unpack(HEADER_FORMAT, raw)
+        if magic != b"WRSERIES":
+            raise ValueError(f"{path} is not a time series file")
+        names = [f.read(FIELD_BYTES).split(b"\0", 1)[0].decode() for _ in range(n_fields)]
+
+    dtype = np.float32 if value_bytes == 4 else np.float64
+    values = np.fromfile(path, dtype=dtype, offset=header_bytes)
+
+    # a run still in progress has n_records = 0 and may end in a partial record
+    n = len(values) // n_fields
+    values = values[:n * n_fields].reshape(n, n_fields)
+
+    meta = {
+        "version": version, "L": L, "M": M, "z": z,
+        "lat": lat.split(b"\0", 1)[0].decode(), "run": run,
+        "stride": stride, "seed": seed, "n_records": n,
+    }
+    return meta, {name: values[:, j] for j, name in enumerate(names)}
+
+
+def series_path(L, M, z, lat, run, sampling_dir=SAMPLING_DIR):
+    z_str = f"{z:.3f}".replace('.', '-')
+    return os.path.join(sampling_dir, "series", f"series_L{L}_M{M}_z{z_str}_{lat}_run{run}.bin")
+
+
+def load_observable(param, L, M, z, lat, run, sampling_dir=SAMPLING_DIR):
+    """Time series of one observable ("crystal", "demixed" or "density") as float64, or None.
+
+    Prefers the binary series file and falls back to the legacy one-value-per-line text files.
+    """
+    path = series_path(L, M, z, lat, run, sampling_dir)
+    if os.path.exists(path):
+        _, fields = read_series(path)
+        return fields[param].astype(np.float64)
+
+    z_str = f"{z:.3f}".replace('.', '-')
+    legacy = os.path.join(sampling_dir, param, f"{param}_L{L}_M{M}_z{z_str}_{lat}_run{run}.txt")
+    if os.path.exists(legacy):
+        return np.loadtxt(legacy)
+
+    return None
+
+
+def summary_path(L, M, z, lat, run, sampling_dir=SAMPLING_DIR):
+    z_str = f"{z:.3f}".replace('.', '-')
+    return os.path.join(sampling_dir, "summary", f"summary_L{L}_M{M}_z{z_str}_{lat}_run{run}.json")
+
+
+def load_summary(L, M, z, lat, run, sampling_dir=SAMPLING_DIR):
+    """Per-run moments written by main.cpp (see src/sim/moments.h), or None if missing.
+
+    summary["observables"][param] holds samples, mean, m2, m3, m4, binder, blocks,
+    mean_error, binder_block_mean and binder_error for each observable after burn-in.
+    """
+    path = summary_path(L, M, z, lat, run, sampling_dir)
+    if not os.path.exists(path):
+        return None
+    with open(path) as f:
+        return json.load(f)
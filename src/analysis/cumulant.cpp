@@ -0,0 +1,279 @@
+#include <argparse/argparse.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../sim/random_stream.h"
+#include "../sim/timeseries.h"
+
+// Per-run Binder cumulant analysis, the native replacement of cumulant_computation.py.
+//
+// The run's time series is read once (one field, after the burn-in) and gives:
+//   cumulant.txt      U = 1 - <x^4> / (3 <x^2>^2) of the whole series
+//   error_bars.txt    standard error of U from non-overlapping blocks of --block samples
+//   bootstrap.txt     U of --bootstrap resamples of the samples drawn with replacement
+//   autocorr.txt      integrated autocorrelation time (g - 1) / 2, with g the statistical
+//                     inefficiency as pymbar.timeseries.statistical_inefficiency defines it
+//   block_curve.txt   (--block-curve) block mean and error of U for a range of block lengths
+// Block sums come from prefix sums of x^2 and x^4, so every block length costs O(n / length).
+// The autocorrelation function is one FFT convolution instead of an O(n * lag) loop. Resample
+// b draws from the Philox stream (seed, b), so the bootstrap does not depend on the thread count.
+
+struct CumulantArgs : public argparse::Args {
+    int &L                        = kwarg("L", "Lattice size (L x L)");
+    int &M                        = kwarg("M", "Number of species");
+    double &z                     = kwarg("z", "Fugacity");
+    std::string &lat              = kwarg("lat", "Lattice Type");
+    int &run                      = kwarg("run", "Run number");
+    std::string &dir              = kwarg("dir", "Sampling directory").set_default("data/sampling");
+    std::string &observable       = kwarg("observable", "crystal, demixed or density").set_default("demixed");
+    int &burn_in                  = kwarg("burn-in", "Samples dropped from the start (-1 = the run's summary, 5000 without one)").set_default(-1);
+    int &block                    = kwarg("block", "Block length (samples) of error_bars.txt").set_default(2000);
+    int &bootstrap                = kwarg("bootstrap", "Bootstrap resamples").set_default(1500);
+    int &threads                  = kwarg("threads", "Bootstrap threads (0 = all cores)").set_default(0);
+    unsigned long long &seed      = kwarg("seed", "Philox seed of the bootstrap").set_default(1);
+    bool &block_curve             = flag("block-curve", "Also write block_curve.txt");
+    int &curve_step               = kwarg("curve-step", "Block lengths of block_curve.txt: step, 2 step, ...").set_default(100);
+    int &curve_max                = kwarg("curve-max", "... up to this length").set_default(4000);
+    std::vector<std::string> &out = arg("directories", "Job directories the products are written to").multi_argument().set_default(std::vector<std::string>{"."});
+};
+
+/* PUT THIS INTO COMMAND LINE (assuming you are in the parent directory as this file)
+
+    g++ -std=c++17 -I./include src/analysis/cumulant.cpp -o cumulant -O3 -pthread
+    ./cumulant --L 48 --M 5 --z 3.6 --lat square --run 1 data/workspace/<job id>
+
+*/
+
+// z as it appears in file names, e.g. 3.6 -> "3-600"
+std::string formatZ(double z) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3) << z;
+    std::string str_z = oss.str();
+    std::replace(str_z.begin(), str_z.end(), '.', '-');
+    return str_z;
+}
+
+double binder(double s2, double s4, double n) {
+    const double m2 = s2 / n;
+    return 1 - (s4 / n) / (3 * m2 * m2);
+}
+
+// burn_in written to the run's summary by main, -1 if there is none
+long long summaryBurnIn(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string text = ss.str();
+    const std::size_t key = text.find("\"burn_in\":");
+    if (!in || key == std::string::npos) return -1;
+    return std::stoll(text.substr(key + 10));
+}
+
+// in-place radix-2 FFT, a.size() a power of two
+void fft(std::vector<std::complex<double>>& a, bool inverse) {
+    const std::size_t n = a.size();
+    for (std::size_t i = 1, j = 0; i < n; i++) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (std::size_t len = 2; len <= n; len <<= 1) {
+        const double angle = 2 * M_PI / len * (inverse ? 1 : -1);
+        const std::complex<double> w_len(std::cos(angle), std::sin(angle));
+        for (std::size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1);
+            for (std::size_t j = 0; j < len / 2; j++) {
+                const std::complex<double> u = a[i + j], v = a[i + j + len / 2] * w;
+                a[i + j] = u + v;
+                a[i + j + len / 2] = u - v;
+                w *= w_len;
+            }
+        }
+    }
+}
+
+// g = 1 + 2 sum_t (1 - t/n) C(t), summed until C drops to zero after t = 3 (pymbar's rule, with
+// C(t) normalized by the n - t pairs at lag t); the lag sums come from one FFT autocorrelation
+double statisticalInefficiency(const std::vector<double>& x) {
+    const std::size_t n = x.size();
+    if (n < 2) return 1;
+    double mean = 0;
+    for (double v : x) mean += v;
+    mean /= n;
+
+    std::size_t size = 1;
+    while (size < 2 * n) size <<= 1;
+    std::vector<std::complex<double>> a(size);
+    double var = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        a[i] = x[i] - mean;
+        var += (x[i] - mean) * (x[i] - mean);
+    }
+    var /= n;
+    if (var == 0) return 1;
+
+    fft(a, false);
+    for (std::complex<double>& c : a) c = std::norm(c);
+    fft(a, true);
+
+    double g = 1;
+    for (std::size_t t = 1; t < n - 1; t++) {
+        const double C = a[t].real() / size / ((n - t) * var);
+        if (C <= 0 && t > 3) break;
+        g += 2 * C * (1 - static_cast<double>(t) / n);
+    }
+    return std::max(g, 1.0);
+}
+
+struct BlockEstimate {
+    double mean = NAN;
+    double error = NAN;
+};
+
+// U of every non-overlapping block of `length` samples: their mean and standard error
+BlockEstimate blockBinder(const std::vector<double>& p2, const std::vector<double>& p4, std::size_t length) {
+    const std::size_t n_blocks = (p2.size() - 1) / length;
+    BlockEstimate e;
+    if (n_blocks == 0) return e;
+
+    double s1 = 0, s2 = 0;
+    for (std::size_t b = 0; b < n_blocks; b++) {
+        const std::size_t lo = b * length, hi = lo + length;
+        const double u = binder(p2[hi] - p2[lo], p4[hi] - p4[lo], length);
+        s1 += u;
+        s2 += u * u;
+    }
+    e.mean = s1 / n_blocks;
+    if (n_blocks > 1) {
+        const double var = std::max(0.0, (s2 - s1 * e.mean) / (n_blocks - 1));
+        e.error = std::sqrt(var / n_blocks);
+    }
+    return e;
+}
+
+int main(int argc, char* argv[]) {
+    CumulantArgs args = argparse::parse<CumulantArgs>(argc, argv);
+
+    if (args.block <= 0 || args.bootstrap < 0 || args.threads < 0 || args.curve_step <= 0) {
+        std::cerr << "Error: --block and --curve-step must be positive, --bootstrap and --threads non-negative." << std::endl;
+        return 1;
+    }
+
+    const std::string run_tag = "L" + std::to_string(args.L) + "_M" + std::to_string(args.M) + "_z" + formatZ(args.z)
+                                + "_" + args.lat + "_run" + std::to_string(args.run);
+
+    // the binary series, or the legacy one-value-per-line text file
+    std::vector<double> data;
+    try {
+        const std::string series = args.dir + "/series/series_" + run_tag + ".bin";
+        const std::string legacy = args.dir + "/" + args.observable + "/" + args.observable + "_" + run_tag + ".txt";
+        if (std::filesystem::exists(series)) {
+            data = readSeriesField(series, args.observable);
+        }
+        else {
+            std::ifstream in(legacy);
+            if (!in) {
+                throw std::runtime_error("Neither " + series + " nor " + legacy + " exists.");
+            }
+            for (double v; in >> v;) data.push_back(v);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    long long burn_in = args.burn_in;
+    if (burn_in < 0) {
+        burn_in = summaryBurnIn(args.dir + "/summary/summary_" + run_tag + ".json");
+        if (burn_in < 0) burn_in = 5000;
+    }
+    if (static_cast<std::size_t>(burn_in) + 2 > data.size()) {
+        std::cerr << "Error: " << data.size() << " samples, fewer than the burn-in of " << burn_in << " plus two." << std::endl;
+        return 1;
+    }
+    data.erase(data.begin(), data.begin() + burn_in);
+    const std::size_t n = data.size();
+
+    // prefix sums of x^2 and x^4: any block's moments in O(1)
+    std::vector<double> p2(n + 1, 0), p4(n + 1, 0);
+    for (std::size_t i = 0; i < n; i++) {
+        const double x2 = data[i] * data[i];
+        p2[i + 1] = p2[i] + x2;
+        p4[i + 1] = p4[i] + x2 * x2;
+    }
+
+    const double U = binder(p2[n], p4[n], n);
+    const BlockEstimate blocks = blockBinder(p2, p4, args.block);
+    const double tau_int = (statisticalInefficiency(data) - 1) / 2;
+
+    std::vector<double> resamples(args.bootstrap);
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        for (int b = next++; b < args.bootstrap; b = next++) {
+            RandomStream rng(args.seed, b);
+            double s2 = 0, s4 = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                const double x = data[rng.below(n)];
+                const double x2 = x * x;
+                s2 += x2;
+                s4 += x2 * x2;
+            }
+            resamples[b] = binder(s2, s4, n);
+        }
+    };
+
+    int n_threads = args.threads > 0 ? args.threads : std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::max(1, std::min(n_threads, args.bootstrap));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    for (const std::string& out : args.out) {
+        auto open = [&](const std::string& name) {
+            std::ofstream file(out + "/" + name);
+            if (!file) {
+                throw std::runtime_error("Could not open " + out + "/" + name + " for writing.");
+            }
+            file << std::setprecision(17);
+            return file;
+        };
+        try {
+            open("cumulant.txt") << U << "\n";
+            open("error_bars.txt") << blocks.error << "\n";
+            open("autocorr.txt") << tau_int << "\n";
+            std::ofstream bootstrap = open("bootstrap.txt");
+            for (double u : resamples) {
+                bootstrap << u << "\n";
+            }
+            if (args.block_curve) {
+                std::ofstream curve = open("block_curve.txt");
+                for (int length = args.curve_step; length <= args.curve_max; length += args.curve_step) {
+                    const BlockEstimate e = blockBinder(p2, p4, length);
+                    curve << length << " " << e.mean << " " << e.error << "\n";
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << run_tag << ": " << n << " samples after " << burn_in << ", U = " << U << " +- " << blocks.error
+              << ", tau_int = " << tau_int << std::endl;
+    return 0;
+}
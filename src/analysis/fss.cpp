@@ -0,0 +1,453 @@
+#include <argparse/argparse.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "../sim/random_stream.h"
+
+// Finite-size-scaling crossing finder, the native replacement of processor.py's reduction.
+//
+// Reads the per-run Binder cumulants main writes to data/sampling/summary/ and, for every
+// bootstrap sample (runs redrawn with replacement within each (L, z)):
+//   - averages the runs of every (L, z)
+//   - for consecutive sizes L < L', fits U_L(z) - U_L'(z) over their common z values with a
+//     least-squares cubic or a natural cubic spline and brackets its roots inside that z window;
+//     with several roots the one nearest --guess (default: the window center) is the crossing
+//     z_c(L), with none the sample is discarded
+//   - fits z_c(L) = z_c + A / L to the crossings (linear least squares in 1 / L)
+// Sample b draws from the Philox stream (seed, b), so the result does not depend on the thread
+// count. Writes <dir>/fss/fss_M<M>_<lat>_<observable>.json (estimates and intervals) and
+// crossings_M<M>_<lat>_<observable>.csv (one row per kept sample), which
+// src/actions/plot_fss.py turns into the figures.
+
+struct FssArgs : public argparse::Args {
+    int &M                        = kwarg("M", "Number of species");
+    std::string &lat              = kwarg("lat", "Lattice Type");
+    std::vector<int> &sizes       = kwarg("L", "Lattice sizes to use (default: all)").multi_argument().set_default(std::vector<int>{});
+    std::string &dir              = kwarg("dir", "Sampling directory").set_default("data/sampling");
+    std::string &observable       = kwarg("observable", "crystal, demixed or density").set_default("demixed");
+    std::string &fit              = kwarg("fit", "Crossing fit: cubic or spline").set_default("cubic");
+    double &guess                 = kwarg("guess", "Crossing picked when a fit has several roots: the nearest (0 = window center)").set_default(0.0);
+    int &bootstrap                = kwarg("bootstrap", "Bootstrap samples").set_default(1500);
+    int &threads                  = kwarg("threads", "Threads (0 = all cores)").set_default(0);
+    unsigned long long &seed      = kwarg("seed", "Philox seed of the bootstrap").set_default(1);
+};
+
+/* PUT THIS INTO COMMAND LINE (assuming you are in the parent directory as this file)
+
+    g++ -std=c++17 -I./include src/analysis/fss.cpp -o fss -O3 -pthread
+    ./fss --M 5 --lat hexagonal
+    python src/actions/plot_fss.py --M 5 --lat hexagonal      (optional figures)
+
+*/
+
+// value after "key": in text (searching from `from`), NaN for null or a missing key
+double jsonNumber(const std::string& text, const std::string& key, std::size_t from = 0) {
+    const std::size_t at = text.find("\"" + key + "\":", from);
+    if (at == std::string::npos) return NAN;
+    std::istringstream in(text.substr(at + key.size() + 3, 32));
+    double v;
+    return in >> v ? v : NAN;
+}
+
+std::string jsonString(const std::string& text, const std::string& key) {
+    const std::size_t at = text.find("\"" + key + "\": \"");
+    if (at == std::string::npos) return "";
+    const std::size_t begin = at + key.size() + 5;
+    return text.substr(begin, text.find('"', begin) - begin);
+}
+
+// least-squares polynomial of degree min(3, n - 1) in the scaled variable (z - center) / scale
+struct Cubic {
+    double center = 0, scale = 1;
+    double c[4] = {0, 0, 0, 0};
+
+    Cubic(const std::vector<double>& x, const std::vector<double>& y) {
+        const int n = x.size();
+        const int d = std::min(3, n - 1) + 1;
+        center = (x.front() + x.back()) / 2;
+        scale = std::max((x.back() - x.front()) / 2, 1e-12);
+
+        // normal equations, Gaussian elimination with partial pivoting
+        double a[4][5] = {};
+        for (int i = 0; i < n; i++) {
+            const double t = (x[i] - center) / scale;
+            double p[4] = {1, t, t * t, t * t * t};
+            for (int r = 0; r < d; r++) {
+                for (int s = 0; s < d; s++) a[r][s] += p[r] * p[s];
+                a[r][d] += p[r] * y[i];
+            }
+        }
+        for (int col = 0; col < d; col++) {
+            int pivot = col;
+            for (int r = col + 1; r < d; r++) {
+                if (std::abs(a[r][col]) > std::abs(a[pivot][col])) pivot = r;
+            }
+            std::swap(a[col], a[pivot]);
+            for (int r = 0; r < d; r++) {
+                if (r == col || a[col][col] == 0) continue;
+                const double f = a[r][col] / a[col][col];
+                for (int s = col; s <= d; s++) a[r][s] -= f * a[col][s];
+            }
+        }
+        for (int r = 0; r < d; r++) {
+            c[r] = a[r][r] != 0 ? a[r][d] / a[r][r] : 0;
+        }
+    }
+
+    double operator()(double z) const {
+        const double t = (z - center) / scale;
+        return c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+    }
+};
+
+// natural cubic spline through (x, y), x increasing
+struct Spline {
+    std::vector<double> x, y, m;        // m: second derivatives at the knots
+
+    Spline(const std::vector<double>& x_, const std::vector<double>& y_) : x(x_), y(y_), m(x_.size(), 0) {
+        const int n = x.size();
+        if (n < 3) return;
+        // tridiagonal system for m[1..n-2] (Thomas algorithm), m[0] = m[n-1] = 0
+        std::vector<double> diag(n, 0), rhs(n, 0), upper(n, 0);
+        for (int i = 1; i < n - 1; i++) {
+            const double h0 = x[i] - x[i - 1], h1 = x[i + 1] - x[i];
+            diag[i] = 2 * (h0 + h1);
+            upper[i] = h1;
+            rhs[i] = 6 * ((y[i + 1] - y[i]) / h1 - (y[i] - y[i - 1]) / h0);
+            if (i > 1) {
+                const double f = h0 / diag[i - 1];
+                diag[i] -= f * upper[i - 1];
+                rhs[i] -= f * rhs[i - 1];
+            }
+        }
+        for (int i = n - 2; i >= 1; i--) {
+            m[i] = (rhs[i] - (i < n - 2 ? upper[i] * m[i + 1] : 0)) / diag[i];
+        }
+    }
+
+    double operator()(double z) const {
+        const int n = x.size();
+        int i = std::upper_bound(x.begin(), x.end(), z) - x.begin() - 1;
+        i = std::max(0, std::min(i, n - 2));
+        const double h = x[i + 1] - x[i];
+        const double a = (x[i + 1] - z) / h, b = (z - x[i]) / h;
+        return a * y[i] + b * y[i + 1] + ((a * a * a - a) * m[i] + (b * b * b - b) * m[i + 1]) * h * h / 6;
+    }
+};
+
+// roots of f in [lo, hi]: sign changes on a fine grid, refined by bisection
+template <typename F>
+std::vector<double> bracketRoots(const F& f, double lo, double hi, int grid = 512) {
+    std::vector<double> roots;
+    double a = lo, fa = f(lo);
+    for (int k = 1; k <= grid; k++) {
+        const double b = lo + (hi - lo) * k / grid, fb = f(b);
+        if (fa == 0) {
+            roots.push_back(a);
+        }
+        else if (fa * fb < 0) {
+            double l = a, r = b, fl = fa;
+            for (int it = 0; it < 100 && r - l > 1e-14 * std::max(1.0, std::abs(l)); it++) {
+                const double mid = (l + r) / 2, fm = f(mid);
+                if ((fm < 0) == (fl < 0)) {
+                    l = mid;
+                    fl = fm;
+                }
+                else {
+                    r = mid;
+                }
+            }
+            roots.push_back((l + r) / 2);
+        }
+        a = b;
+        fa = fb;
+    }
+    if (fa == 0) roots.push_back(hi);
+    return roots;
+}
+
+// mean, standard deviation and central percentile intervals of a sample
+struct Summary {
+    double mean = NAN, error = NAN, median = NAN;
+    double lo68 = NAN, hi68 = NAN, lo95 = NAN, hi95 = NAN;
+};
+
+Summary summarize(std::vector<double> v) {
+    Summary s;
+    if (v.empty()) return s;
+    const std::size_t n = v.size();
+    double s1 = 0, s2 = 0;
+    for (double x : v) {
+        s1 += x;
+        s2 += x * x;
+    }
+    s.mean = s1 / n;
+    s.error = n > 1 ? std::sqrt(std::max(0.0, (s2 - s1 * s.mean) / (n - 1))) : NAN;
+    std::sort(v.begin(), v.end());
+    auto quantile = [&](double q) {
+        const double pos = q * (n - 1);
+        const std::size_t i = static_cast<std::size_t>(pos);
+        return i + 1 < n ? v[i] + (pos - i) * (v[i + 1] - v[i]) : v[n - 1];
+    };
+    s.median = quantile(0.5);
+    s.lo68 = quantile(0.15865);
+    s.hi68 = quantile(0.84135);
+    s.lo95 = quantile(0.025);
+    s.hi95 = quantile(0.975);
+    return s;
+}
+
+// z_c and A of z_c(L) = z_c + A / L, least squares in x = 1 / L
+std::pair<double, double> scalingFit(const std::vector<int>& L, const std::vector<double>& crossing) {
+    const std::size_t n = L.size();
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        const double x = 1.0 / L[i];
+        sx += x;
+        sy += crossing[i];
+        sxx += x * x;
+        sxy += x * crossing[i];
+    }
+    const double A = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    return {(sy - A * sx) / n, A};
+}
+
+int main(int argc, char* argv[]) {
+    FssArgs args = argparse::parse<FssArgs>(argc, argv);
+
+    if (args.fit != "cubic" && args.fit != "spline") {
+        std::cerr << "Error: --fit must be cubic or spline." << std::endl;
+        return 1;
+    }
+    if (args.bootstrap <= 0 || args.threads < 0) {
+        std::cerr << "Error: --bootstrap must be positive and --threads non-negative." << std::endl;
+        return 1;
+    }
+
+    // U of every run: runs[L][z] = {U, ...}
+    std::map<int, std::map<double, std::vector<double>>> runs;
+    std::size_t n_runs = 0;
+    try {
+        for (const auto& entry : std::filesystem::directory_iterator(args.dir + "/summary")) {
+            const std::string name = entry.path().filename().string();
+            if (name.rfind("summary_L", 0) != 0 || entry.path().extension() != ".json") continue;
+
+            std::ifstream in(entry.path());
+            std::stringstream ss;
+            ss << in.rdbuf();
+            const std::string text = ss.str();
+
+            const int L = jsonNumber(text, "L");
+            if (jsonNumber(text, "M") != args.M || jsonString(text, "lat") != args.lat) continue;
+            if (!args.sizes.empty() && std::find(args.sizes.begin(), args.sizes.end(), L) == args.sizes.end()) continue;
+
+            const std::size_t obs = text.find("\"" + args.observable + "\": {");
+            const double U = obs == std::string::npos ? NAN : jsonNumber(text, "binder", obs);
+            if (!std::isfinite(U)) continue;    // no samples after the burn-in yet
+
+            runs[L][jsonNumber(text, "z")].push_back(U);
+            n_runs++;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<int> sizes;
+    for (const auto& size : runs) sizes.push_back(size.first);
+    if (sizes.size() < 2) {
+        std::cerr << "Error: found " << sizes.size() << " lattice sizes for M = " << args.M << ", " << args.lat
+                  << "; crossings need at least two." << std::endl;
+        return 1;
+    }
+    const std::size_t n_pairs = sizes.size() - 1;
+    const std::vector<int> L_finite(sizes.begin(), sizes.end() - 1);    // smaller size of each pair
+
+    // common z values of each pair of consecutive sizes
+    std::vector<std::vector<double>> pair_z(n_pairs);
+    for (std::size_t p = 0; p < n_pairs; p++) {
+        for (const auto& point : runs[sizes[p + 1]]) {
+            if (runs[sizes[p]].count(point.first)) pair_z[p].push_back(point.first);
+        }
+        if (pair_z[p].size() < 2) {
+            std::cerr << "Error: L = " << sizes[p] << " and L = " << sizes[p + 1] << " share fewer than two z values." << std::endl;
+            return 1;
+        }
+    }
+
+    // one bootstrap sample per b: crossings of every pair (empty if a pair has none), z_c and A
+    struct Sample {
+        std::vector<double> crossing;
+        bool multiple_roots = false;
+        double z_c = NAN, A = NAN;
+    };
+    std::vector<Sample> samples(args.bootstrap);
+
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        for (int b = next++; b < args.bootstrap; b = next++) {
+            RandomStream rng(args.seed, b);
+
+            // mean of the resampled runs of every (L, z), drawn in (L, z) order
+            std::map<int, std::map<double, double>> U;
+            for (const auto& size : runs) {
+                for (const auto& point : size.second) {
+                    const std::vector<double>& u = point.second;
+                    double sum = 0;
+                    for (std::size_t r = 0; r < u.size(); r++) {
+                        sum += u[rng.below(u.size())];
+                    }
+                    U[size.first][point.first] = sum / u.size();
+                }
+            }
+
+            Sample& sample = samples[b];
+            for (std::size_t p = 0; p < n_pairs; p++) {
+                const std::vector<double>& z = pair_z[p];
+                std::vector<double> diff(z.size());
+                for (std::size_t i = 0; i < z.size(); i++) {
+                    diff[i] = U[sizes[p]][z[i]] - U[sizes[p + 1]][z[i]];
+                }
+
+                std::vector<double> roots;
+                if (args.fit == "spline") {
+                    roots = bracketRoots(Spline(z, diff), z.front(), z.back());
+                }
+                else {
+                    roots = bracketRoots(Cubic(z, diff), z.front(), z.back());
+                }
+                if (roots.empty()) {
+                    sample.crossing.clear();
+                    break;
+                }
+                const double guess = args.guess > 0 ? args.guess : (z.front() + z.back()) / 2;
+                double best = roots[0];
+                for (double r : roots) {
+                    if (std::abs(r - guess) < std::abs(best - guess)) best = r;
+                }
+                sample.multiple_roots |= roots.size() > 1;
+                sample.crossing.push_back(best);
+            }
+
+            if (sample.crossing.size() == n_pairs && n_pairs >= 2) {
+                std::tie(sample.z_c, sample.A) = scalingFit(L_finite, sample.crossing);
+            }
+        }
+    };
+
+    int n_threads = args.threads > 0 ? args.threads : std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::max(1, std::min(n_threads, args.bootstrap));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    std::vector<std::vector<double>> crossings(n_pairs);
+    std::vector<double> z_c, A;
+    int kept = 0, multiple = 0;
+    for (const Sample& s : samples) {
+        if (s.crossing.size() != n_pairs) continue;
+        kept++;
+        multiple += s.multiple_roots;
+        for (std::size_t p = 0; p < n_pairs; p++) crossings[p].push_back(s.crossing[p]);
+        if (std::isfinite(s.z_c)) {
+            z_c.push_back(s.z_c);
+            A.push_back(s.A);
+        }
+    }
+    if (kept == 0) {
+        std::cerr << "Error: no bootstrap sample has a crossing for every pair of sizes." << std::endl;
+        return 1;
+    }
+
+    // fit to the mean crossings, as a cross-check of the bootstrap mean
+    std::vector<double> mean_crossing(n_pairs);
+    for (std::size_t p = 0; p < n_pairs; p++) mean_crossing[p] = summarize(crossings[p]).mean;
+    const std::pair<double, double> mean_fit = n_pairs >= 2 ? scalingFit(L_finite, mean_crossing) : std::pair<double, double>(NAN, NAN);
+
+    const std::string stem = args.dir + "/fss/";
+    const std::string tag = "M" + std::to_string(args.M) + "_" + args.lat + "_" + args.observable;
+    std::filesystem::create_directories(stem);
+
+    auto num = [](double v) {
+        std::ostringstream ss;
+        if (std::isfinite(v)) ss << std::setprecision(10) << v;
+        else ss << "null";
+        return ss.str();
+    };
+    auto stats = [&](const Summary& s) {
+        return "{\"mean\": " + num(s.mean) + ", \"error\": " + num(s.error) + ", \"median\": " + num(s.median)
+               + ", \"interval_68\": [" + num(s.lo68) + ", " + num(s.hi68) + "], \"interval_95\": ["
+               + num(s.lo95) + ", " + num(s.hi95) + "]}";
+    };
+
+    const std::string json_path = stem + "fss_" + tag + ".json";
+    std::ofstream json(json_path);
+    if (!json) {
+        std::cerr << "Could not open " << json_path << " for writing." << std::endl;
+        return 1;
+    }
+    json << "{\n";
+    json << "  \"M\": " << args.M << ",\n";
+    json << "  \"lat\": \"" << args.lat << "\",\n";
+    json << "  \"observable\": \"" << args.observable << "\",\n";
+    json << "  \"fit\": \"" << args.fit << "\",\n";
+    json << "  \"runs\": " << n_runs << ",\n";
+    json << "  \"samples\": " << args.bootstrap << ",\n";
+    json << "  \"kept\": " << kept << ",\n";
+    json << "  \"multiple_roots\": " << multiple << ",\n";
+    json << "  \"crossings\": [";
+    for (std::size_t p = 0; p < n_pairs; p++) {
+        json << (p ? "," : "") << "\n    {\"L\": " << sizes[p] << ", \"L_next\": " << sizes[p + 1]
+             << ", \"z\": " << stats(summarize(crossings[p])) << "}";
+    }
+    json << "\n  ],\n";
+    json << "  \"z_c\": " << stats(summarize(z_c)) << ",\n";
+    json << "  \"A\": " << stats(summarize(A)) << ",\n";
+    json << "  \"z_c_of_mean_crossings\": " << num(mean_fit.first) << ",\n";
+    json << "  \"A_of_mean_crossings\": " << num(mean_fit.second) << "\n";
+    json << "}\n";
+
+    const std::string csv_path = stem + "crossings_" + tag + ".csv";
+    std::ofstream csv(csv_path);
+    if (!csv) {
+        std::cerr << "Could not open " << csv_path << " for writing." << std::endl;
+        return 1;
+    }
+    csv << "sample";
+    for (int L : L_finite) csv << ",z_L" << L;
+    csv << ",z_c,A\n";
+    csv << std::setprecision(10);
+    for (int b = 0; b < args.bootstrap; b++) {
+        const Sample& s = samples[b];
+        if (s.crossing.size() != n_pairs) continue;
+        csv << b;
+        for (double c : s.crossing) csv << "," << c;
+        csv << "," << s.z_c << "," << s.A << "\n";
+    }
+
+    const Summary zc = summarize(z_c);
+    std::cout << "Critical point: " << zc.mean << " +- " << zc.error << " (95%: " << zc.lo95 << " .. " << zc.hi95 << ")" << std::endl;
+    if (multiple > 0) {
+        std::cout << "Warning: " << multiple << " samples had more than one crossing for some pair of sizes." << std::endl;
+    }
+    if (kept < args.bootstrap) {
+        std::cout << "Discarded " << args.bootstrap - kept << " samples without a crossing; kept " << kept << "." << std::endl;
+    }
+    std::cout << "Wrote " << json_path << " and " << csv_path << std::endl;
+    return 0;
+}
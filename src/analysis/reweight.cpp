@@ -0,0 +1,284 @@
+#include <argparse/argparse.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../sim/histogram.h"
+#include "../sim/random_stream.h"
+
+// Multiple-histogram (Ferrenberg-Swendsen / WHAM) reweighting in z of the per-N histograms
+// main writes to data/sampling/histogram/. All runs of one (L, M, lat) are combined into a
+// single estimate of the weight of every particle number N, from which the mean and Binder
+// cumulant of an order parameter follow at any z inside (or close to) the simulated range.
+//
+// With n_k samples of run group k at fugacity z_k and H(N) samples at N over all groups,
+//     D(N)  = sum_k n_k z_k^N / Z_k,
+//     Z_k   = sum_N H(N) z_k^N / D(N)          (iterated to self-consistency),
+//     <f>_z = sum_N F(N) z^N / D(N) / sum_N H(N) z^N / D(N),
+// where F(N) is the sum of f over the samples at N. Runs at the same z form one group.
+// Errors come from a bootstrap that redraws runs with replacement within each z group.
+
+struct ReweightArgs : public argparse::Args {
+    int &L                        = kwarg("L", "Lattice size (L x L)");
+    int &M                        = kwarg("M", "Number of species");
+    std::string &lat              = kwarg("lat", "Lattice Type");
+    std::string &dir              = kwarg("dir", "Sampling directory").set_default("data/sampling");
+    std::string &observable       = kwarg("observable", "demixed or crystal").set_default("demixed");
+    double &z_min                 = kwarg("z-min", "Lowest z of the curve (0 = lowest simulated)").set_default(0.0);
+    double &z_max                 = kwarg("z-max", "Highest z of the curve (0 = highest simulated)").set_default(0.0);
+    int &points                   = kwarg("points", "Points on the z grid").set_default(201);
+    int &bootstrap                = kwarg("bootstrap", "Bootstrap resamples (0 = no errors)").set_default(200);
+    int &threads                  = kwarg("threads", "Bootstrap threads (0 = all cores)").set_default(0);
+    unsigned long long &seed      = kwarg("seed", "Philox seed of the bootstrap").set_default(1);
+};
+
+/* PUT THIS INTO COMMAND LINE (assuming you are in the parent directory as this file)
+
+    g++ -std=c++17 -I./include src/analysis/reweight.cpp -o reweight -O3 -pthread
+    ./reweight --L 48 --M 5 --lat hexagonal --z-min 5.42 --z-max 5.52
+
+*/
+
+// one z: the runs simulated there
+struct RunGroup {
+    double z;
+    std::vector<const HistogramFile*> runs;
+};
+
+// combined histogram of a selection of runs (the full data set or one bootstrap resample)
+struct Combined {
+    std::vector<double> log_z;              // per group
+    std::vector<double> n;                  // samples per group
+    std::vector<double> H;                  // samples per N, all groups
+    std::vector<std::array<double, 4>> F;   // power sums of the observable per N, all groups
+};
+
+double logSumExp(const std::vector<double>& x) {
+    double m = -INFINITY;
+    for (double v : x) m = std::max(m, v);
+    if (!std::isfinite(m)) return m;
+    double s = 0;
+    for (double v : x) s += std::exp(v - m);
+    return m + std::log(s);
+}
+
+Combined combine(const std::vector<RunGroup>& groups, const std::vector<std::vector<int>>& picks,
+                 std::size_t n_sites, bool demixed) {
+    Combined c;
+    c.H.assign(n_sites + 1, 0.0);
+    c.F.assign(n_sites + 1, {0, 0, 0, 0});
+
+    for (std::size_t k = 0; k < groups.size(); k++) {
+        double n_k = 0;
+        for (int r : picks[k]) {
+            const HistogramFile& h = *groups[k].runs[r];
+            for (std::size_t b = 0; b < h.bins.size(); b++) {
+                const HistogramBin& bin = h.bins[b];
+                const std::size_t N = h.n_min + b;
+                const double* sums = demixed ? bin.demixed : bin.crystal;
+                c.H[N] += bin.count;
+                for (int p = 0; p < 4; p++) c.F[N][p] += sums[p];
+            }
+            n_k += h.samples;
+        }
+        c.log_z.push_back(std::log(groups[k].z));
+        c.n.push_back(n_k);
+    }
+    return c;
+}
+
+// ln D(N) for the given ln Z_k; -inf where H(N) = 0
+std::vector<double> logDensity(const Combined& c, const std::vector<double>& log_Z) {
+    std::vector<double> log_D(c.H.size(), -INFINITY);
+    std::vector<double> terms(c.log_z.size());
+    for (std::size_t N = 0; N < c.H.size(); N++) {
+        if (c.H[N] == 0) continue;
+        for (std::size_t k = 0; k < c.log_z.size(); k++) {
+            terms[k] = (c.n[k] > 0 ? std::log(c.n[k]) : -INFINITY) + N * c.log_z[k] - log_Z[k];
+        }
+        log_D[N] = logSumExp(terms);
+    }
+    return log_D;
+}
+
+// self-consistent ln Z_k (ln Z_0 = 0), starting from `log_Z`
+std::vector<double> solveWham(const Combined& c, std::vector<double> log_Z) {
+    const std::size_t K = c.log_z.size();
+    std::vector<double> terms;
+    for (int iter = 0; iter < 100000; iter++) {
+        std::vector<double> log_D = logDensity(c, log_Z);
+        std::vector<double> next(K);
+        for (std::size_t k = 0; k < K; k++) {
+            terms.clear();
+            for (std::size_t N = 0; N < c.H.size(); N++) {
+                if (c.H[N] > 0) terms.push_back(std::log(c.H[N]) + N * c.log_z[k] - log_D[N]);
+            }
+            next[k] = logSumExp(terms);
+        }
+        double shift = next[0];
+        double change = 0;
+        for (std::size_t k = 0; k < K; k++) {
+            next[k] -= shift;
+            change = std::max(change, std::abs(next[k] - log_Z[k]));
+        }
+        log_Z = next;
+        if (change < 1e-10) break;
+    }
+    return log_Z;
+}
+
+// {mean, binder} of the observable at each z of the grid
+std::vector<std::array<double, 2>> curve(const Combined& c, const std::vector<double>& log_Z, const std::vector<double>& grid) {
+    std::vector<double> log_D = logDensity(c, log_Z);
+    std::vector<std::array<double, 2>> out;
+    for (double z : grid) {
+        const double lz = std::log(z);
+        double a_max = -INFINITY;
+        for (std::size_t N = 0; N < c.H.size(); N++) {
+            if (c.H[N] > 0) a_max = std::max(a_max, N * lz - log_D[N]);
+        }
+        double norm = 0, m1 = 0, m2 = 0, m4 = 0;
+        for (std::size_t N = 0; N < c.H.size(); N++) {
+            if (c.H[N] == 0) continue;
+            double w = std::exp(N * lz - log_D[N] - a_max);
+            norm += w * c.H[N];
+            m1 += w * c.F[N][0];
+            m2 += w * c.F[N][1];
+            m4 += w * c.F[N][3];
+        }
+        m1 /= norm;
+        m2 /= norm;
+        m4 /= norm;
+        out.push_back({m1, 1 - (1.0/3)*(m4/(m2*m2))});
+    }
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    ReweightArgs args = argparse::parse<ReweightArgs>(argc, argv);
+
+    if (args.observable != "demixed" && args.observable != "crystal") {
+        std::cerr << "Error: --observable must be demixed or crystal." << std::endl;
+        return 1;
+    }
+    if (args.points < 1 || args.bootstrap < 0 || args.threads < 0) {
+        std::cerr << "Error: --points must be positive, --bootstrap and --threads non-negative." << std::endl;
+        return 1;
+    }
+    const bool demixed = args.observable == "demixed";
+
+    // histogram_L<L>_M<M>_z<z>_<lat>_run<run>.bin
+    const std::string prefix = "histogram_L" + std::to_string(args.L) + "_M" + std::to_string(args.M) + "_z";
+    const std::string infix = "_" + args.lat + "_run";
+
+    std::vector<HistogramFile> files;
+    try {
+        for (const auto& entry : std::filesystem::directory_iterator(args.dir + "/histogram")) {
+            const std::string name = entry.path().filename().string();
+            if (name.rfind(prefix, 0) != 0 || name.find(infix) == std::string::npos) continue;
+            HistogramFile h = readHistogram(entry.path().string());
+            if (h.info.L != args.L || h.info.M != args.M || h.info.lat != args.lat || h.samples == 0) continue;
+            files.push_back(std::move(h));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (files.empty()) {
+        std::cerr << "Error: no histograms for L = " << args.L << ", M = " << args.M << ", " << args.lat << " in " << args.dir << "/histogram" << std::endl;
+        return 1;
+    }
+
+    std::map<double, std::vector<const HistogramFile*>> by_z;
+    for (const HistogramFile& h : files) {
+        by_z[h.info.z].push_back(&h);
+    }
+    std::vector<RunGroup> groups;
+    for (auto& [z, runs] : by_z) {
+        groups.push_back({z, runs});
+        if (runs.size() < 2 && args.bootstrap > 0) {
+            std::cerr << "Warning: only one run at z = " << z << ", bootstrap errors will be too small." << std::endl;
+        }
+    }
+    const std::size_t n_sites = files.front().n_sites;
+
+    double z_lo = args.z_min > 0 ? args.z_min : groups.front().z;
+    double z_hi = args.z_max > 0 ? args.z_max : groups.back().z;
+    std::vector<double> grid(args.points);
+    for (int i = 0; i < args.points; i++) {
+        grid[i] = args.points == 1 ? z_lo : z_lo + (z_hi - z_lo) * i / (args.points - 1);
+    }
+
+    std::vector<std::vector<int>> all(groups.size());
+    for (std::size_t k = 0; k < groups.size(); k++) {
+        for (std::size_t r = 0; r < groups[k].runs.size(); r++) all[k].push_back(r);
+    }
+
+    Combined full = combine(groups, all, n_sites, demixed);
+    std::vector<double> log_Z = solveWham(full, std::vector<double>(groups.size(), 0.0));
+    std::vector<std::array<double, 2>> estimate = curve(full, log_Z, grid);
+
+    // bootstrap: runs redrawn with replacement inside each z group, resample b uses the Philox stream (seed, b)
+    std::vector<std::vector<std::array<double, 2>>> resamples(args.bootstrap);
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        for (int b = next++; b < args.bootstrap; b = next++) {
+            RandomStream rng(args.seed, b);
+            std::vector<std::vector<int>> picks(groups.size());
+            for (std::size_t k = 0; k < groups.size(); k++) {
+                const std::size_t n_runs = groups[k].runs.size();
+                for (std::size_t r = 0; r < n_runs; r++) picks[k].push_back(rng.below(n_runs));
+            }
+            Combined c = combine(groups, picks, n_sites, demixed);
+            resamples[b] = curve(c, solveWham(c, log_Z), grid);
+        }
+    };
+
+    int n_threads = args.threads > 0 ? args.threads : std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::max(1, std::min(n_threads, args.bootstrap));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    std::string out_path = args.dir + "/reweight/reweight_L" + std::to_string(args.L) + "_M" + std::to_string(args.M) + "_" + args.lat + "_" + args.observable + ".csv";
+    std::filesystem::create_directories(args.dir + "/reweight");
+    std::ofstream out(out_path);
+    if (!out) {
+        std::cerr << "Could not open " << out_path << " for writing." << std::endl;
+        return 1;
+    }
+
+    out << "z,mean,mean_err,binder,binder_err\n";
+    out << std::setprecision(10);
+    for (std::size_t i = 0; i < grid.size(); i++) {
+        double err[2] = {NAN, NAN};
+        if (args.bootstrap > 1) {
+            for (int q = 0; q < 2; q++) {
+                double s1 = 0, s2 = 0;
+                for (const auto& r : resamples) {
+                    s1 += r[i][q];
+                    s2 += r[i][q] * r[i][q];
+                }
+                double mean = s1 / args.bootstrap;
+                err[q] = std::sqrt(std::max(0.0, (s2 / args.bootstrap - mean * mean) * args.bootstrap / (args.bootstrap - 1)));
+            }
+        }
+        out << grid[i] << "," << estimate[i][0] << "," << err[0] << "," << estimate[i][1] << "," << err[1] << "\n";
+    }
+
+    std::cout << "Wrote " << out_path << " (" << files.size() << " runs at " << groups.size() << " z values)" << std::endl;
+    return 0;
+}
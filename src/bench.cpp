@@ -0,0 +1,340 @@
+#include <argparse/argparse.hpp>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lattice/lattice_graph.h"
+#include "lattice/lattice_io.h"
+#include "sim/cluster_search.h"
+#include "sim/neighbor_check.h"
+#include "sim/nfold.h"
+#include "sim/observables.h"
+#include "sim/random_stream.h"
+#include "sim/site_storage.h"
+#include "sim/sweep_kernels.h"
+#include "sim/sweep_stats.h"
+
+// Sweep throughput benchmark over a matrix of (lattice type, L, M, z, kernel).
+//
+// Every point starts from randomFill with the same seed, runs --warmup untimed sweeps and then
+// --sweeps timed ones, with the per-sweep measurements (crystal, demixed, density) timed
+// separately. The random kernel then runs another --sweeps sweeps with a probe that reads the
+// cycle counter around every move, which splits the cost by move type: insert (any attempt at
+// an empty site), remove and cluster (the two kinds of attempt at an occupied site). The cost
+// of the timer itself is measured and subtracted. Results go out as one JSON document.
+
+struct BenchArgs : public argparse::Args {
+    std::vector<std::string> &lat     = kwarg("lat", "Lattice types").multi_argument().set_default(std::vector<std::string>{"square", "triangular", "hexagonal"});
+    std::vector<int> &L               = kwarg("L", "Lattice sizes").multi_argument().set_default(std::vector<int>{24, 96});
+    std::vector<int> &M               = kwarg("M", "Numbers of species").multi_argument().set_default(std::vector<int>{3, 5});
+    std::vector<double> &z            = kwarg("z", "Fugacities").multi_argument().set_default(std::vector<double>{1.0, 3.6, 6.0});
+    std::vector<std::string> &kernel  = kwarg("kernel", "Kernels: random, checkerboard, bkl").multi_argument().set_default(std::vector<std::string>{"random", "checkerboard", "bkl"});
+    int &sweeps                       = kwarg("sweeps", "Timed sweeps per point").set_default(200);
+    int &warmup                       = kwarg("warmup", "Untimed sweeps before the timing").set_default(100);
+    unsigned long long &seed          = kwarg("seed", "Philox seed").set_default(12345);
+    int &threads                      = kwarg("threads", "Threads of the checkerboard kernel").set_default(1);
+    bool &packed                      = flag("packed", "Store the lattice as 4-bit nibbles (M <= 15)");
+    std::string &out                  = kwarg("out", "JSON output file (- = stdout)").set_default("-");
+};
+
+/* PUT THIS INTO COMMAND LINE (assuming you are in the parent directory as this file)
+
+    g++ -std=c++17 -I./include src/bench.cpp -o bench -O3 -pthread -fopenmp
+    ./bench --out bench.json
+    ./bench --lat square --L 48 --M 5 --z 3.6 --kernel random bkl --sweeps 1000
+
+*/
+
+// sweep() probe: cycles and count of every move outcome
+struct MoveTimer {
+    uint64_t start = 0;
+    uint64_t count[N_MOVE_OUTCOMES] = {};
+    uint64_t cycles[N_MOVE_OUTCOMES] = {};
+    uint64_t cluster_sites = 0;
+
+    void begin() { start = ticks(); }
+    void end(MoveOutcome outcome, int size = 0) {
+        cycles[outcome] += ticks() - start;
+        count[outcome]++;
+        cluster_sites += size;
+    }
+};
+
+// cycles of one begin() / end() pair with nothing in between
+inline double timerOverhead() {
+    MoveTimer timer;
+    const int n = 1000000;
+    for (int m = 0; m < n; m++) {
+        timer.begin();
+        timer.end(INSERTED);
+    }
+    return static_cast<double>(timer.cycles[INSERTED]) / n;
+}
+
+struct MoveCost {
+    uint64_t attempts = 0;
+    uint64_t accepted = 0;
+    double ns_per_attempt = NAN;
+};
+
+struct BenchResult {
+    std::string lat;
+    int L, M;
+    double z;
+    std::string kernel;
+    std::size_t sites;
+    double sweep_seconds = 0;
+    double observables_seconds = 0;
+    double density = 0;
+    bool has_moves = false;
+    MoveCost insert, remove, cluster;
+    double mean_cluster = NAN;
+    double timer_overhead_ns = NAN;
+};
+
+template <typename Sites>
+BenchResult benchmark(const BenchArgs& args, const LatticeData& lattice, const std::string& lat, int L, int M, double z,
+                      const std::string& kernel, double overhead_cycles) {
+    using clock = std::chrono::steady_clock;
+
+    const LatticeGraph& adj = lattice.graph;
+    const int k = lattice.n_sublattices;
+
+    BenchResult result;
+    result.lat = lat;
+    result.L = L;
+    result.M = M;
+    result.z = z;
+    result.kernel = kernel;
+    result.sites = adj.size();
+
+    Sites nodes(adj.size(), 0);
+    RandomStream rng(args.seed);
+    randomFill(nodes, adj, rng, M, z);
+
+    ObservableTracker observables(M, k, lattice.sublattice);
+    observables.rebuild(nodes);
+
+    ClusterSearch cluster_search(nodes.size());
+    MoveRates rates(z, M);
+
+    std::vector<std::vector<int>> sublattice_sites;
+    std::vector<int> recolor_shift;
+    if (kernel == "checkerboard") {
+        sublattice_sites.resize(k + 1);
+        for (int i = 0; i < nodes.size(); i++) {
+            sublattice_sites[lattice.sublattice[i]].push_back(i);
+        }
+        recolor_shift.assign(nodes.size(), 0);
+    }
+
+    std::unique_ptr<NFoldEngine<Sites>> nfold;
+    if (kernel == "bkl") {
+        nfold = std::make_unique<NFoldEngine<Sites>>(adj, M, z);
+        nfold->rebuild(nodes);
+    }
+
+    auto step = [&](int s) {
+        if (nfold) {
+            nfold->sweep(nodes, observables, rng);
+            return;
+        }
+        withDegree(adj, [&](auto degree) {
+            if (kernel == "checkerboard") {
+                sweepCheckerboard<degree>(nodes, adj, sublattice_sites, observables, cluster_search,
+                                          recolor_shift, args.seed, s, M, z, args.threads);
+            }
+            else {
+                sweep<degree>(nodes, adj, observables, cluster_search, rates, rng, M);
+            }
+        });
+    };
+
+    int s = 1;
+    for (; s <= args.warmup; s++) {
+        step(s);
+    }
+
+    double sink = 0;    // keeps the measurements from being optimized away
+    for (int t = 0; t < args.sweeps; t++, s++) {
+        const auto t0 = clock::now();
+        step(s);
+        const auto t1 = clock::now();
+        sink += observables.crystal() + observables.demixed() + observables.density();
+        const auto t2 = clock::now();
+        result.sweep_seconds += std::chrono::duration<double>(t1 - t0).count();
+        result.observables_seconds += std::chrono::duration<double>(t2 - t1).count();
+    }
+    result.density = observables.density();
+    if (sink < 0) std::cerr << sink;
+
+    if (kernel == "random") {
+        MoveTimer timer;
+        const auto t0 = clock::now();
+        const uint64_t c0 = ticks();
+        for (int t = 0; t < args.sweeps; t++) {
+            withDegree(adj, [&](auto degree) {
+                sweep<degree>(nodes, adj, observables, cluster_search, rates, rng, M, timer);
+            });
+        }
+        const double ns_per_cycle = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / (ticks() - c0);
+
+        auto cost = [&](std::initializer_list<MoveOutcome> outcomes, MoveOutcome accepted) {
+            MoveCost c;
+            uint64_t cycles = 0;
+            for (MoveOutcome o : outcomes) {
+                c.attempts += timer.count[o];
+                cycles += timer.cycles[o];
+            }
+            c.accepted = timer.count[accepted];
+            if (c.attempts > 0) {
+                c.ns_per_attempt = std::max(0.0, static_cast<double>(cycles) / c.attempts - overhead_cycles) * ns_per_cycle;
+            }
+            return c;
+        };
+        result.has_moves = true;
+        result.insert = cost({INSERTED, INSERT_REJECTED, INSERT_CONFLICT}, INSERTED);
+        result.remove = cost({REMOVED, REMOVE_REJECTED}, REMOVED);
+        result.cluster = cost({RECOLORED}, RECOLORED);
+        if (timer.count[RECOLORED] > 0) {
+            result.mean_cluster = static_cast<double>(timer.cluster_sites) / timer.count[RECOLORED];
+        }
+        result.timer_overhead_ns = overhead_cycles * ns_per_cycle;
+    }
+
+    return result;
+}
+
+void writeBenchJson(std::ostream& out, const BenchArgs& args, const std::vector<BenchResult>& results) {
+    // JSON has no NaN; undefined numbers are written as null
+    auto num = [](double v) {
+        std::ostringstream ss;
+        if (std::isfinite(v)) ss << std::setprecision(6) << v;
+        else ss << "null";
+        return ss.str();
+    };
+    auto move = [&](const MoveCost& c) {
+        return "{\"attempts\": " + std::to_string(c.attempts) + ", \"accepted\": " + std::to_string(c.accepted)
+               + ", \"ns_per_attempt\": " + num(c.ns_per_attempt) + "}";
+    };
+
+    out << "{\n";
+    out << "  \"sweeps\": " << args.sweeps << ",\n";
+    out << "  \"warmup\": " << args.warmup << ",\n";
+    out << "  \"seed\": " << args.seed << ",\n";
+    out << "  \"threads\": " << args.threads << ",\n";
+    out << "  \"storage\": \"" << (args.packed ? "packed" : "bytes") << "\",\n";
+#ifdef WR_HAVE_X86
+    out << "  \"avx2\": " << (cpuHasAvx2() ? "true" : "false") << ",\n";
+#else
+    out << "  \"avx2\": false,\n";
+#endif
+    out << "  \"results\": [";
+
+    for (std::size_t r = 0; r < results.size(); r++) {
+        const BenchResult& b = results[r];
+        const double moves = static_cast<double>(args.sweeps) * b.sites;
+
+        out << (r ? "," : "") << "\n    {\n";
+        out << "      \"lat\": \"" << b.lat << "\",\n";
+        out << "      \"L\": " << b.L << ",\n";
+        out << "      \"M\": " << b.M << ",\n";
+        out << "      \"z\": " << num(b.z) << ",\n";
+        out << "      \"kernel\": \"" << b.kernel << "\",\n";
+        out << "      \"sites\": " << b.sites << ",\n";
+        out << "      \"site_updates_per_second\": " << num(moves / b.sweep_seconds) << ",\n";
+        out << "      \"ns_per_move\": " << num(b.sweep_seconds * 1e9 / moves) << ",\n";
+        out << "      \"observables_ns_per_sweep\": " << num(b.observables_seconds * 1e9 / args.sweeps) << ",\n";
+        out << "      \"density\": " << num(b.density);
+        if (b.has_moves) {
+            out << ",\n      \"moves\": {\n";
+            out << "        \"insert\": " << move(b.insert) << ",\n";
+            out << "        \"remove\": " << move(b.remove) << ",\n";
+            out << "        \"cluster\": " << move(b.cluster) << "\n";
+            out << "      },\n";
+            out << "      \"mean_cluster_size\": " << num(b.mean_cluster) << ",\n";
+            out << "      \"timer_overhead_ns\": " << num(b.timer_overhead_ns);
+        }
+        out << "\n    }";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchArgs args = argparse::parse<BenchArgs>(argc, argv);
+
+    if (args.sweeps <= 0 || args.warmup < 0 || args.threads <= 0) {
+        std::cerr << "Error: --sweeps and --threads must be positive, --warmup non-negative." << std::endl;
+        return 1;
+    }
+    for (const std::string& kernel : args.kernel) {
+        if (kernel != "random" && kernel != "checkerboard" && kernel != "bkl") {
+            std::cerr << "Error: --kernel must be random, checkerboard or bkl." << std::endl;
+            return 1;
+        }
+        if (args.packed && kernel == "checkerboard") {
+            std::cerr << "Error: --packed does not support the checkerboard kernel." << std::endl;
+            return 1;
+        }
+    }
+    for (int M : args.M) {
+        if (M <= 0 || M > (args.packed ? 15 : 255)) {
+            std::cerr << "Error: M must be between 1 and 255 (15 with --packed)." << std::endl;
+            return 1;
+        }
+    }
+    for (double z : args.z) {
+        if (z <= 0) {
+            std::cerr << "Error: z must be positive." << std::endl;
+            return 1;
+        }
+    }
+
+    const double overhead_cycles = timerOverhead();
+
+    std::vector<BenchResult> results;
+    for (const std::string& lat : args.lat) {
+        for (int L : args.L) {
+            LatticeData lattice;
+            try {
+                lattice = loadLattice("src/lattice/adj-lists", L, lat, false);   // reads a cache, never writes one
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+
+            for (int M : args.M) {
+                for (double z : args.z) {
+                    for (const std::string& kernel : args.kernel) {
+                        results.push_back(args.packed
+                            ? benchmark<PackedSites>(args, lattice, lat, L, M, z, kernel, overhead_cycles)
+                            : benchmark<ByteSites>(args, lattice, lat, L, M, z, kernel, overhead_cycles));
+                        const BenchResult& b = results.back();
+                        std::cerr << lat << " L=" << L << " M=" << M << " z=" << z << " " << kernel << ": "
+                                  << args.sweeps * b.sites / b.sweep_seconds / 1e6 << " M updates/s" << std::endl;
+                    }
+                }
+            }
+        }
+    }
+
+    if (args.out == "-") {
+        writeBenchJson(std::cout, args, results);
+        return 0;
+    }
+
+    std::ofstream out(args.out);
+    if (!out) {
+        std::cerr << "Error: could not open " << args.out << " for writing." << std::endl;
+        return 1;
+    }
+    writeBenchJson(out, args, results);
+    return 0;
+}
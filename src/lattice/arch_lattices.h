@@ -0,0 +1,196 @@
+#ifndef WR_ARCH_LATTICES_H
+#define WR_ARCH_LATTICES_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lattice_graph.h"
+
+// Native port of arch_lattices.py: the same unit cells (basis vectors + site offsets),
+// but the periodic nearest-neighbor graph is built directly instead of through netket.
+//
+// Sites are numbered the way netket numbers them, site = (i0 * L + i1) * n_basis + s for
+// cell (i0, i1) and basis site s, so the generated adjacency is identical to the
+// adj_list_<L>_<lat>.txt files and to any data already produced with them.
+
+using Vec2 = std::array<double, 2>;
+
+struct UnitCell {
+    Vec2 a1;                    // basis vectors
+    Vec2 a2;
+    std::vector<Vec2> sites;    // site offsets inside the cell
+};
+
+inline UnitCell archUnitCell(const std::string& lattice) {
+    const double sq2 = std::sqrt(2.0);
+    const double sq3 = std::sqrt(3.0);
+    const double sq6 = std::sqrt(6.0);
+
+    const Vec2 x = {1.0, 0.0};
+    const Vec2 y = {0.0, 1.0};
+    const Vec2 tri = {0.5, sq3 / 2};
+
+    if (lattice == "square") {
+        return {x, y, {{0.0, 0.0}}};
+    }
+    else if (lattice == "triangular") {
+        return {x, tri, {{0.0, 0.0}}};
+    }
+    else if (lattice == "hexagonal") {
+        return {x, tri, {{0.0, 0.0}, {0.5, sq3 / 6}}};
+    }
+    else if (lattice == "kagome") {
+        return {x, tri, {{0.5, 0.0}, {0.25, sq3 / 4}, {0.75, sq3 / 4}}};
+    }
+    else if (lattice == "leaf") {
+        return {x, tri, {
+            {5.0 / 14, sq3 / 14},
+            {5.0 / 7, sq3 / 7},
+            {15.0 / 14, 3 * sq3 / 14},
+            {8.0 / 7, 3 * sq3 / 7},
+            {11.0 / 14, 5 * sq3 / 14},
+            {3.0 / 7, 2 * sq3 / 7},
+        }};
+    }
+    else if (lattice == "ruby") {
+        const double a = 1 / (1 + sq3);
+        return {x, tri, {
+            {a * sq3 / 2, a / 2},
+            {(1 + sq3 / 2) * a, a / 2},
+            {0.5, (1 + sq3) / 2 * a},
+            {1.0, a},
+            {(3 - (2 + sq3) * a) / 2, (sq3 - a) / 2},
+            {(3 - sq3 * a) / 2, (sq3 - a) / 2},
+        }};
+    }
+    else if (lattice == "star") {
+        const double a = 1 / (2 + sq3);
+        return {x, tri, {
+            {0.5, a / 2},
+            {(1 - a) / 2, (1 + sq3) / 2 * a},
+            {(1 + a) / 2, (1 + sq3) / 2 * a},
+            {1.0, (sq3 - a) / 2},
+            {1 - a / 2, (sq3 - (1 + sq3) * a) / 2},
+            {1 + a / 2, (sq3 - (1 + sq3) * a) / 2},
+        }};
+    }
+    else if (lattice == "SHD") {
+        const double a = 2 / (6 + 2 * sq3);
+        std::vector<Vec2> cell = {
+            {(1 + sq3 / 2) * a, a / 2},
+            {(2 + sq3 / 2) * a, a / 2},
+            {(1 + sq3 / 2) * a, (0.5 + sq3) * a},
+            {(2 + sq3 / 2) * a, (0.5 + sq3) * a},
+            {(1 + sq3) / 2 * a, (1 + sq3) * a / 2},
+            {(5 + sq3) / 2 * a, (1 + sq3) * a / 2},
+        };
+        const Vec2 shift = {sq3 / 2 * (1 + sq3) * a, 0.5 * (1 + sq3) * a};
+        for (int s = 0; s < 6; s++) {
+            cell.push_back({cell[s][0] + shift[0], cell[s][1] + shift[1]});
+        }
+        return {x, tri, cell};
+    }
+    else if (lattice == "trellis") {
+        return {{1 + sq3 / 2, 0.5}, y, {{0.5, 0.5}, {(1.0 + sq3) / 2.0, 1.0}}};
+    }
+    else if (lattice == "bathroom") {
+        const double a = 1.0 / (1.0 + sq2);
+        return {x, y, {{a / 2, 0.5}, {0.5, a / 2}, {1.0 - a / 2, 0.5}, {0.5, 1.0 - a / 2}}};
+    }
+    else if (lattice == "snub") {
+        const double a = 1.0 / std::sqrt(2.0 + sq3);
+        const double u = a * std::sqrt(7.0 / 8.0 + sq3 / 2.0);
+        const double v = a * sq2 / 4.0;
+        const double w = a * sq6 / 4.0;
+        return {x, y, {{u, v}, {v, w}, {1 - u, 1 - v}, {1 - v, 1 - w}}};
+    }
+
+    throw std::invalid_argument("Invalid lattice type: " + lattice);
+}
+
+inline bool isArchLattice(const std::string& lattice) {
+    try {
+        archUnitCell(lattice);
+        return true;
+    } catch (const std::invalid_argument&) {
+        return false;
+    }
+}
+
+// Periodic L x L nearest-neighbor graph of a unit cell. Nearest neighbors are all pairs at
+// the smallest site-site distance (same rule netket uses), found once for the unit cell as a
+// stencil of (s -> t, cell shift) and then stamped over every cell with wrap-around.
+inline LatticeGraph generateArchLattice(const UnitCell& cell, int L) {
+    if (L <= 0) {
+        throw std::invalid_argument("Lattice size must be positive.");
+    }
+
+    struct Bond { int s, t, d0, d1; double dist; };
+
+    const int nb = cell.sites.size();
+    const int R = 3;    // site offsets can sit up to ~1 cell outside the parallelogram
+
+    std::vector<Bond> bonds;
+    double d_min = INFINITY;
+
+    for (int s = 0; s < nb; s++) {
+        for (int t = 0; t < nb; t++) {
+            for (int d0 = -R; d0 <= R; d0++) {
+                for (int d1 = -R; d1 <= R; d1++) {
+                    if (s == t && d0 == 0 && d1 == 0) continue;
+                    double dx = d0 * cell.a1[0] + d1 * cell.a2[0] + cell.sites[t][0] - cell.sites[s][0];
+                    double dy = d0 * cell.a1[1] + d1 * cell.a2[1] + cell.sites[t][1] - cell.sites[s][1];
+                    double dist = std::sqrt(dx * dx + dy * dy);
+                    bonds.push_back({s, t, d0, d1, dist});
+                    d_min = std::min(d_min, dist);
+                }
+            }
+        }
+    }
+
+    const double tol = 1e-5 * d_min;
+    bonds.erase(std::remove_if(bonds.begin(), bonds.end(),
+                               [&](const Bond& b) { return b.dist > d_min + tol; }),
+                bonds.end());
+
+    auto wrap = [L](int i) { return ((i % L) + L) % L; };
+
+    const int n_sites = L * L * nb;
+    std::vector<int> offsets;
+    std::vector<int> neighbors;
+    offsets.reserve(n_sites + 1);
+    offsets.push_back(0);
+
+    std::vector<int> row;
+    for (int i0 = 0; i0 < L; i0++) {
+        for (int i1 = 0; i1 < L; i1++) {
+            for (int s = 0; s < nb; s++) {
+                const int site = (i0 * L + i1) * nb + s;
+                row.clear();
+                for (const Bond& b : bonds) {
+                    if (b.s != s) continue;
+                    int v = (wrap(i0 + b.d0) * L + wrap(i1 + b.d1)) * nb + b.t;
+                    if (v != site) row.push_back(v);
+                }
+                // tiny L can fold two bonds onto the same site
+                std::sort(row.begin(), row.end());
+                row.erase(std::unique(row.begin(), row.end()), row.end());
+
+                neighbors.insert(neighbors.end(), row.begin(), row.end());
+                offsets.push_back(neighbors.size());
+            }
+        }
+    }
+
+    return LatticeGraph(std::move(offsets), std::move(neighbors));
+}
+
+inline LatticeGraph genLattice(const std::string& lattice, int L) {
+    return generateArchLattice(archUnitCell(lattice), L);
+}
+
+#endif
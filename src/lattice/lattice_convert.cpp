@@ -0,0 +1,45 @@
+#include <argparse/argparse.hpp>
+#include <iostream>
+#include <string>
+
+#include "arch_lattices.h"
+#include "lattice_io.h"
+
+// Builds src/lattice/adj-lists/adj_list_<L>_<lat>.bin, the binary, mmap-able lattice read by
+// main (CSR arrays + sublattice labels + checksum). Archimedean lattices are generated
+// natively; anything else (or --from-text) is converted from adj_list_<L>_<lat>.txt.
+
+struct ConvertArgs : public argparse::Args {
+    int &L                        = kwarg("L", "Lattice size (L x L)");
+    std::string &lat              = kwarg("lat", "Lattice Type");
+    std::string &dir              = kwarg("dir", "Adjacency list directory").set_default("src/lattice/adj-lists");
+    bool &from_text               = flag("from-text", "Convert the existing .txt adjacency list instead of generating");
+};
+
+/* PUT THIS INTO COMMAND LINE (assuming you are in the parent directory as this file)
+
+    g++ -std=c++17 -I./include src/lattice/lattice_convert.cpp -o lattice_convert -O3
+    ./lattice_convert --L 24 --lat square
+
+*/
+
+int main(int argc, char* argv[]) {
+    ConvertArgs args = argparse::parse<ConvertArgs>(argc, argv);
+
+    std::string stem = args.dir + "/adj_list_" + std::to_string(args.L) + "_" + args.lat;
+
+    try {
+        bool native = isArchLattice(args.lat) && !args.from_text;
+        LatticeData data = labelLattice(native ? genLattice(args.lat, args.L) : readAdjacencyText(stem + ".txt"), args.L);
+        writeLatticeBinary(stem + ".bin", data);
+
+        std::cout << "Wrote " << stem << ".bin: " << data.graph.size() << " sites, "
+                  << data.graph.neighborCount() << " neighbor entries, "
+                  << data.n_sublattices << " sublattices" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#ifndef WR_LATTICE_GRAPH_H
+#define WR_LATTICE_GRAPH_H
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Compressed-sparse-row (CSR) lattice graph.
+//
+// The neighbors of site i live in neighbors[offsets[i] .. offsets[i+1]), so the whole
+// graph is two contiguous arrays instead of one heap allocation per site. Regular lattices
+// (square, triangular, hexagonal, kagome, ...) have the same coordination number at every
+// site; for those degree() is non-zero and neighbor lookups skip the offsets array entirely.
+
+struct NeighborRange {
+    const int* first;
+    const int* last;
+
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    int size() const { return static_cast<int>(last - first); }
+    int operator[](int j) const { return first[j]; }
+};
+
+class LatticeGraph {
+public:
+    LatticeGraph() = default;
+
+    // build from the bracketed adjacency list format written by lattice_generation.py
+    explicit LatticeGraph(const std::vector<std::vector<int>>& adj) {
+        std::vector<int> offsets;
+        std::vector<int> neighbors;
+        offsets.reserve(adj.size() + 1);
+        offsets.push_back(0);
+        for (const auto& row : adj) {
+            neighbors.insert(neighbors.end(), row.begin(), row.end());
+            offsets.push_back(static_cast<int>(neighbors.size()));
+        }
+        adopt(std::move(offsets), std::move(neighbors));
+    }
+
+    // take ownership of already flattened CSR arrays (offsets.size() == n_sites + 1)
+    LatticeGraph(std::vector<int> offsets, std::vector<int> neighbors) {
+        adopt(std::move(offsets), std::move(neighbors));
+    }
+
+    // view CSR arrays owned by someone else (e.g. a read-only memory mapping); `keep_alive`
+    // holds that owner for as long as any copy of this graph exists
+    LatticeGraph(const int* offsets, const int* neighbors, int n_sites, std::shared_ptr<const void> keep_alive)
+        : storage_(std::move(keep_alive)), offsets_(offsets), neighbors_(neighbors), n_sites_(n_sites) {
+        finalize();
+    }
+
+    int size() const { return n_sites_; }
+
+    // coordination number of a regular lattice, 0 if the degree varies from site to site
+    int degree() const { return degree_; }
+    bool isRegular() const { return degree_ > 0; }
+
+    int degree(int i) const {
+        return degree_ > 0 ? degree_ : offsets_[i + 1] - offsets_[i];
+    }
+
+    NeighborRange neighbors(int i) const {
+        if (degree_ > 0) {
+            const int* p = neighbors_ + static_cast<std::size_t>(i) * degree_;
+            return {p, p + degree_};
+        }
+        return {neighbors_ + offsets_[i], neighbors_ + offsets_[i + 1]};
+    }
+
+    // neighbors of site i when the degree is known at compile time (D == degree() > 0)
+    template <int D>
+    const int* regularNeighbors(int i) const {
+        return neighbors_ + static_cast<std::size_t>(i) * D;
+    }
+
+    const int* offsetData() const { return offsets_; }
+    const int* neighborData() const { return neighbors_; }
+    std::size_t neighborCount() const { return n_sites_ > 0 ? static_cast<std::size_t>(offsets_[n_sites_]) : 0; }
+
+private:
+    struct OwnedArrays {
+        std::vector<int> offsets;
+        std::vector<int> neighbors;
+    };
+
+    void adopt(std::vector<int> offsets, std::vector<int> neighbors) {
+        if (offsets.empty()) {
+            offsets.push_back(0);
+        }
+        auto owned = std::make_shared<OwnedArrays>(OwnedArrays{std::move(offsets), std::move(neighbors)});
+        offsets_ = owned->offsets.data();
+        neighbors_ = owned->neighbors.data();
+        n_sites_ = static_cast<int>(owned->offsets.size()) - 1;
+        if (static_cast<std::size_t>(owned->offsets.back()) != owned->neighbors.size()) {
+            throw std::runtime_error("Malformed CSR offsets for lattice graph.");
+        }
+        storage_ = std::move(owned);
+        finalize();
+    }
+
+    void finalize() {
+        if (n_sites_ < 0 || (n_sites_ > 0 && offsets_[0] != 0)) {
+            throw std::runtime_error("Malformed CSR offsets for lattice graph.");
+        }
+
+        const std::size_t n_neighbors = neighborCount();
+        for (std::size_t e = 0; e < n_neighbors; e++) {
+            if (neighbors_[e] < 0 || neighbors_[e] >= n_sites_) {
+                throw std::runtime_error("Lattice graph neighbor index out of range.");
+            }
+        }
+
+        degree_ = n_sites_ > 0 ? offsets_[1] - offsets_[0] : 0;
+        for (int i = 0; i < n_sites_ && degree_ > 0; i++) {
+            if (offsets_[i + 1] - offsets_[i] != degree_) {
+                degree_ = 0;
+            }
+        }
+    }
+
+    std::shared_ptr<const void> storage_;
+    const int* offsets_ = nullptr;
+    const int* neighbors_ = nullptr;
+    int n_sites_ = 0;
+    int degree_ = 0;
+};
+
+#endif
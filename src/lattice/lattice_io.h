@@ -0,0 +1,283 @@
+#ifndef WR_LATTICE_IO_H
+#define WR_LATTICE_IO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arch_lattices.h"
+#include "lattice_graph.h"
+#include "sublattice.h"
+
+// Binary lattice cache (adj_list_<L>_<lat>.bin), written once per lattice and mmap'ed
+// read-only by every simulation afterwards, so concurrent jobs on a node share the same
+// page-cache pages instead of each re-parsing the bracketed text file.
+//
+// Layout (native little-endian, every array int32):
+//   LatticeFileHeader
+//   offsets[n_sites + 1]
+//   neighbors[n_neighbors]
+//   sublattice[n_sites]          labels 1..n_sublattices
+// `checksum` is FNV-1a (64 bit) over everything after the header.
+
+constexpr char LATTICE_FILE_MAGIC[8] = {'W', 'R', 'L', 'A', 'T', 0, 0, 0};
+constexpr uint32_t LATTICE_FILE_VERSION = 1;
+
+struct LatticeFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    uint64_t n_sites;
+    uint64_t n_neighbors;
+    uint32_t degree;            // 0 for irregular lattices
+    uint32_t n_sublattices;
+    uint64_t checksum;
+};
+static_assert(sizeof(LatticeFileHeader) == 48, "lattice file header must stay 48 bytes");
+
+struct LatticeData {
+    LatticeGraph graph;
+    std::vector<int> sublattice;    // sublattice label (1..n_sublattices) of every site
+    int n_sublattices = 0;
+};
+
+inline uint64_t fnv1a64(const void* data, std::size_t bytes, uint64_t h = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < bytes; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// parses the "[a, b, c]" per-line format written by lattice_generation.py
+inline LatticeGraph readAdjacencyText(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Missing adjacency list: " + path);
+    }
+
+    // flatten straight into CSR arrays: one offsets entry per site, neighbors back to back
+    std::vector<int> offsets = {0};
+    std::vector<int> neighbors;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        // turn “[”, “]”, “,” into plain spaces:
+        for (char& c : line) {
+            if (c=='[' || c==']' || c==',') c = ' ';
+        }
+
+        std::istringstream iss(line);
+
+        int neighbor;
+        while (iss >> neighbor) {
+            neighbors.push_back(neighbor);
+        }
+
+        offsets.push_back(neighbors.size());
+    }
+
+    return LatticeGraph(std::move(offsets), std::move(neighbors));
+}
+
+// labels the sublattices (2 if bipartite, otherwise 3) of an L x L lattice
+inline LatticeData labelLattice(LatticeGraph graph, int L) {
+    LatticeData data;
+    auto [k, labels] = labelSublattices(graph, L);
+    data.n_sublattices = k;
+    data.sublattice = std::move(labels);
+    data.graph = std::move(graph);
+    return data;
+}
+
+// writes to a process-unique temporary file and renames it into place, so concurrent jobs
+// racing to build the same cache never observe a partially written file
+inline void writeLatticeBinary(const std::string& path, const LatticeData& data) {
+    const LatticeGraph& g = data.graph;
+    const std::size_t n = g.size();
+
+    LatticeFileHeader header{};
+    std::memcpy(header.magic, LATTICE_FILE_MAGIC, sizeof(header.magic));
+    header.version = LATTICE_FILE_VERSION;
+    header.header_bytes = sizeof(LatticeFileHeader);
+    header.n_sites = n;
+    header.n_neighbors = g.neighborCount();
+    header.degree = g.degree();
+    header.n_sublattices = data.n_sublattices;
+
+    uint64_t h = fnv1a64(g.offsetData(), (n + 1) * sizeof(int));
+    h = fnv1a64(g.neighborData(), g.neighborCount() * sizeof(int), h);
+    h = fnv1a64(data.sublattice.data(), n * sizeof(int), h);
+    header.checksum = h;
+
+    const std::string tmp = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Could not open " + tmp + " for writing.");
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(g.offsetData()), (n + 1) * sizeof(int));
+        out.write(reinterpret_cast<const char*>(g.neighborData()), g.neighborCount() * sizeof(int));
+        out.write(reinterpret_cast<const char*>(data.sublattice.data()), n * sizeof(int));
+        if (!out) {
+            std::remove(tmp.c_str());
+            throw std::runtime_error("Failed writing lattice cache " + tmp);
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Could not move lattice cache into place: " + path);
+    }
+}
+
+// read-only shared mapping of a whole file, unmapped when the last LatticeGraph viewing it goes away
+struct MappedFile {
+    void* addr = MAP_FAILED;
+    std::size_t bytes = 0;
+
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not stat " + path);
+        }
+        bytes = static_cast<std::size_t>(st.st_size);
+        if (bytes > 0) {
+            addr = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error("Could not mmap " + path);
+        }
+    }
+
+    ~MappedFile() {
+        if (addr != MAP_FAILED) {
+            munmap(addr, bytes);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+inline LatticeData mapLatticeBinary(const std::string& path) {
+    auto file = std::make_shared<MappedFile>(path);
+
+    if (file->bytes < sizeof(LatticeFileHeader)) {
+        throw std::runtime_error("Truncated lattice cache: " + path);
+    }
+    const auto* header = static_cast<const LatticeFileHeader*>(file->addr);
+    if (std::memcmp(header->magic, LATTICE_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        throw std::runtime_error("Not a lattice cache file: " + path);
+    }
+    if (header->version != LATTICE_FILE_VERSION || header->header_bytes != sizeof(LatticeFileHeader)) {
+        throw std::runtime_error("Unsupported lattice cache version in " + path);
+    }
+
+    // every index is an int, which also keeps the payload size below from overflowing
+    if (header->n_sites > static_cast<uint64_t>(std::numeric_limits<int>::max())
+        || header->n_neighbors > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error("Lattice cache sizes out of range: " + path);
+    }
+
+    const std::size_t n = header->n_sites;
+    const std::size_t payload = (2 * n + 1 + header->n_neighbors) * sizeof(int);
+    if (file->bytes != sizeof(LatticeFileHeader) + payload) {
+        throw std::runtime_error("Lattice cache size does not match its header: " + path);
+    }
+
+    const char* body = static_cast<const char*>(file->addr) + sizeof(LatticeFileHeader);
+    if (fnv1a64(body, payload) != header->checksum) {
+        throw std::runtime_error("Lattice cache checksum mismatch: " + path);
+    }
+
+    const int* offsets = reinterpret_cast<const int*>(body);
+    const int* neighbors = offsets + n + 1;
+    const int* labels = neighbors + header->n_neighbors;
+
+    // a matching checksum only means the file is as written; the CSR arrays are read without
+    // bounds checks by neighbors(), regularNeighbors<D>() and the gathers, so check them here
+    if (offsets[0] != 0 || static_cast<uint64_t>(offsets[n]) != header->n_neighbors) {
+        throw std::runtime_error("Lattice cache offsets do not span the neighbor array: " + path);
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        if (offsets[i + 1] < offsets[i]) {
+            throw std::runtime_error("Lattice cache offsets are not monotone: " + path);
+        }
+    }
+    for (std::size_t e = 0; e < header->n_neighbors; e++) {
+        if (neighbors[e] < 0 || static_cast<std::size_t>(neighbors[e]) >= n) {
+            throw std::runtime_error("Neighbor index out of range in lattice cache: " + path);
+        }
+    }
+
+    // the observables index per-sublattice arrays by these labels
+    const int k = static_cast<int>(header->n_sublattices);
+    if (k < 1) {
+        throw std::runtime_error("Invalid sublattice count in lattice cache: " + path);
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        if (labels[i] < 1 || labels[i] > k) {
+            throw std::runtime_error("Sublattice label out of range in lattice cache: " + path);
+        }
+    }
+
+    LatticeData data;
+    data.n_sublattices = header->n_sublattices;
+    data.sublattice.assign(labels, labels + n);
+    data.graph = LatticeGraph(offsets, neighbors, static_cast<int>(n), file);
+    if (static_cast<uint32_t>(data.graph.degree()) != header->degree) {
+        throw std::runtime_error("Lattice cache degree does not match its neighbor lists: " + path);
+    }
+    return data;
+}
+
+// Loads <dir>/adj_list_<L>_<lat>.bin if a valid cache exists. Otherwise the lattice is
+// generated natively (arch_lattices.h) or, for lattice types not known here, parsed from
+// adj_list_<L>_<lat>.txt; the sublattices are labeled and, when write_cache is set, the
+// .bin is left behind for the next job.
+inline LatticeData loadLattice(const std::string& dir, int L, const std::string& lat, bool write_cache = true) {
+    const std::string stem = dir + "/adj_list_" + std::to_string(L) + "_" + lat;
+    const std::string bin_path = stem + ".bin";
+
+    if (access(bin_path.c_str(), R_OK) == 0) {
+        try {
+            return mapLatticeBinary(bin_path);
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: ignoring lattice cache (" << e.what() << ")" << std::endl;
+        }
+    }
+
+    LatticeData data = labelLattice(isArchLattice(lat) ? genLattice(lat, L) : readAdjacencyText(stem + ".txt"), L);
+
+    if (write_cache) {
+        try {
+            writeLatticeBinary(bin_path, data);
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
+    }
+    return data;
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef WR_SUBLATTICE_H
+#define WR_SUBLATTICE_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lattice_graph.h"
+
+// Sublattice labeling (proper k-coloring with labels 1..k) in O(N) for every lattice we run:
+//
+//   1. bipartite lattices: BFS 2-coloring
+//   2. otherwise 3 colors, taken from a coloring of the p x p-cell quotient of the lattice
+//      (sites with the same basis index and the same cell coordinates mod p), tried for
+//      p = 1, 2, 3, ... dividing L. Every lattice edge maps onto a quotient edge, so a
+//      valid quotient coloring tiles into a valid lattice coloring; this recovers the
+//      unit-cell sublattices of the Archimedean lattices (e.g. p = 3 for triangular).
+//   3. unknown graphs: bounded, iterative backtracking over the whole lattice.
+//
+// Sites are assumed numbered as site = (i0 * L + i1) * n_basis + s (netket / arch_lattices.h);
+// step 2 only ever returns colorings that are valid on the full graph regardless.
+
+// BFS 2-coloring with labels 1/2; empty if the graph has an odd cycle
+inline std::vector<int> bipartiteLabels(const LatticeGraph& adj) {
+    const int n = adj.size();
+    std::vector<int> color(n, 0);   // 0 = uncolored
+    std::vector<int> queue(n);
+
+    for (int start = 0; start < n; ++start) {
+        if (color[start] != 0) continue;  // already visited in another component
+
+        int head = 0, tail = 0;
+        color[start] = 1;
+        queue[tail++] = start;
+
+        while (head < tail) {
+            int u = queue[head++];
+            for (int v : adj.neighbors(u)) {
+                if (color[v] == 0) {
+                    color[v] = 3 - color[u];    // opposite color
+                    queue[tail++] = v;
+                }
+                else if (color[v] == color[u]) {
+                    return {};                  // same-color neighbor → not bipartite
+                }
+            }
+        }
+    }
+
+    return color;
+}
+
+inline bool isBipartite(const LatticeGraph& adj) {
+    return adj.size() == 0 || !bipartiteLabels(adj).empty();
+}
+
+// number of sublattices (colors) used for the crystal order parameter: 2 for bipartite
+// lattices, 3 otherwise
+inline int sublatticeCount(const LatticeGraph& G) {
+    return isBipartite(G) ? 2 : 3;
+}
+
+inline bool isProperColoring(const LatticeGraph& G, const std::vector<int>& color) {
+    if (static_cast<int>(color.size()) != G.size()) return false;
+    for (int v = 0; v < G.size(); v++) {
+        if (color[v] <= 0) return false;
+        for (int u : G.neighbors(v)) {
+            if (color[u] == color[v]) return false;
+        }
+    }
+    return true;
+}
+
+/*
+
+* Citation:
+* Wicaksono, J. K. (2025). Greedy vs Backtracking: A comparative study of
+* graph vertex coloring algorithms with C++ implementations. Makalah
+* IF1220 Matematika Diskrit, Institut Teknologi Bandung.
+
+*/
+
+// Backtracking k-coloring with an explicit stack instead of recursion (no stack overflow on
+// large lattices). Vertices are visited in BFS order so every vertex after the first of its
+// component already has a colored neighbor, and the search gives up after `max_steps` color
+// assignments. Returns an empty vector if no coloring was found within the budget.
+inline std::vector<int> boundedBacktrackColoring(const LatticeGraph& G, int k, long long max_steps) {
+    const int n = G.size();
+
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<char> seen(n, 0);
+    for (int start = 0; start < n; start++) {
+        if (seen[start]) continue;
+        seen[start] = 1;
+        order.push_back(start);
+        for (std::size_t head = order.size() - 1; head < order.size(); head++) {
+            for (int v : G.neighbors(order[head])) {
+                if (!seen[v]) {
+                    seen[v] = 1;
+                    order.push_back(v);
+                }
+            }
+        }
+    }
+
+    auto isSafe = [&](int v, int c, const std::vector<int>& color) {
+        for (int u : G.neighbors(v)) {
+            if (color[u] == c) return false;
+        }
+        return true;
+    };
+
+    std::vector<int> color(n, 0);
+    int pos = 0;
+    long long steps = 0;
+
+    while (pos < n) {
+        const int v = order[pos];
+        int c = color[v] + 1;           // resume after the color tried last time (0 = fresh)
+        color[v] = 0;
+        while (c <= k && !isSafe(v, c, color)) c++;
+
+        if (c <= k) {
+            color[v] = c;
+            pos++;
+            if (++steps > max_steps) return {};
+        }
+        else {
+            if (pos == 0) return {};    // exhausted: no k-coloring
+            pos--;                      // backtrack
+        }
+    }
+
+    return color;
+}
+
+// coloring of the p x p quotient tiled over the lattice, empty if the quotient has a
+// self-loop (p too small) or cannot be colored
+inline std::vector<int> quotientColoring(const LatticeGraph& G, int L, int p, int k) {
+    const int n = G.size();
+    const int nb = n / (L * L);
+    const int nq = p * p * nb;
+
+    auto quotient = [&](int site) {
+        int s = site % nb;
+        int cell = site / nb;
+        int i0 = cell / L, i1 = cell % L;
+        return ((i0 % p) * p + (i1 % p)) * nb + s;
+    };
+
+    std::vector<std::vector<int>> q_adj(nq);
+    for (int v = 0; v < n; v++) {
+        int qv = quotient(v);
+        for (int u : G.neighbors(v)) {
+            int qu = quotient(u);
+            if (qu == qv) return {};
+            q_adj[qv].push_back(qu);
+        }
+    }
+
+    std::vector<int> q_color = boundedBacktrackColoring(LatticeGraph(q_adj), k, 1000000);
+    if (q_color.empty()) return {};
+
+    std::vector<int> color(n);
+    for (int v = 0; v < n; v++) {
+        color[v] = q_color[quotient(v)];
+    }
+    return color;
+}
+
+// Labels every site with its sublattice (1..k). Returns {k, labels}; throws if no coloring
+// with k = 3 was found within the search budget.
+inline std::pair<int, std::vector<int>> labelSublattices(const LatticeGraph& G, int L) {
+    const int n = G.size();
+    if (n == 0) return {2, {}};
+
+    std::vector<int> color = bipartiteLabels(G);
+    if (!color.empty()) return {2, color};
+
+    const int k = 3;
+
+    if (L > 0 && n % (L * L) == 0) {
+        for (int p = 1; p <= 6; p++) {
+            if (L % p != 0) continue;
+            color = quotientColoring(G, L, p, k);
+            if (!color.empty() && isProperColoring(G, color)) return {k, color};
+        }
+    }
+
+    color = boundedBacktrackColoring(G, k, 64LL * n + 1000000);
+    if (color.empty()) {
+        throw std::runtime_error("No valid " + std::to_string(k) + "-coloring of the lattice found "
+                                 "(e.g. triangular lattices need L to be a multiple of 3).");
+    }
+    return {k, color};
+}
+
+#endif
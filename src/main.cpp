@@ -4,6 +4,31 @@
 #include <complex>
 #include <algorithm>
 #include <filesystem>
+#include <atomic>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "lattice/lattice_graph.h"
+#include "lattice/lattice_io.h"
+#include "sim/checkpoint.h"
+#include "sim/cluster_labels.h"
+#include "sim/cluster_stats.h"
+#include "sim/cluster_search.h"
+#include "sim/equilibration.h"
+#include "sim/histogram.h"
+#include "sim/moments.h"
+#include "sim/neighbor_check.h"
+#include "sim/nfold.h"
+#include "sim/observables.h"
+#include "sim/random_stream.h"
+#include "sim/site_storage.h"
+#include "sim/sweep_kernels.h"
+#include "sim/sweep_stats.h"
+#include "sim/tempering.h"
+#include "sim/timeseries.h"
 
 
 using namespace std;
@@ -13,305 +38,79 @@ using namespace std;
 // z = fugacity (absolute activity) -> constant value, same chemical potential throughout (grand-canonical ensemble)
 
 struct MyArgs : public argparse::Args {
-    double &z                    = kwarg("z", "Fugacity (absolute activity) value");
+    double &z                    = kwarg("z", "Fugacity (absolute activity) value").set_default(0.0);
     int &L                        = kwarg("L", "Lattice size (L x L)");
     int &M                        = kwarg("M", "Number of species");
     string &lat                    = kwarg("lat", "Lattice Type");
     int &run                        = kwarg("run", "Run number");
+    unsigned long long &seed        = kwarg("seed", "Philox seed (0 = draw one from std::random_device)").set_default(0);
+    bool &float64                   = flag("float64", "Store the time series as float64 instead of float32");
+    int &sweeps                     = kwarg("sweeps", "Maximum number of sweeps").set_default(1000000);
+    int &burn_in                    = kwarg("burn-in", "Sweeps discarded before accumulating moments (the minimum with --equilibrate)").set_default(10000);
+    bool &equilibrate               = flag("equilibrate", "End the burn-in once MSER finds all observables equilibrated");
+    double &target_error            = kwarg("target-error", "Stop once the demixed Binder cumulant's block error is below this (0 = run all sweeps)").set_default(0.0);
+    int &block                      = kwarg("block", "Block length (sweeps) for the block error estimates").set_default(2000);
+    bool &no_series                 = flag("no-series", "Skip the raw time series, only write the per-run summary");
+    int &checkpoint_every           = kwarg("checkpoint-every", "Sweeps between checkpoints (0 = never)").set_default(10000);
+    bool &resume                    = flag("resume", "Continue from the run's checkpoint if there is one");
+    int &replicas                   = kwarg("replicas", "Independent runs run, run+1, ... simulated in this process").set_default(1);
+    int &threads                    = kwarg("threads", "Worker threads for --replicas / --z-grid (0 = all cores)").set_default(0);
+    string &kernel                  = kwarg("kernel", "Sweep kernel: random (default), checkerboard (sublattice-parallel, OpenMP) or bkl (rejection-free n-fold way)").set_default("random");
+    int &cluster_sweep_every        = kwarg("cluster-sweep-every", "Sweeps between full cluster recolorings (0 = never)").set_default(0);
+    bool &packed                    = flag("packed", "Store the lattice as 4-bit nibbles (M <= 15) instead of bytes");
+    int &cluster_stats_every        = kwarg("cluster-stats-every", "Sweeps between cluster-size / percolation samples after the burn-in (0 = never)").set_default(0);
+    std::vector<double> &z_grid     = kwarg("z-grid", "Fugacities for parallel tempering (replaces --z)").multi_argument().set_default(std::vector<double>{});
+    int &swap_every                 = kwarg("swap-every", "Sweeps between replica-exchange attempts with --z-grid").set_default(1);
+#ifdef WR_STATS
+    int &stats_every                = kwarg("stats-every", "Sweeps between snapshots of the move / timing statistics (0 = only at the end; moves are counted by --kernel random only)").set_default(0);
+#endif
 };
 
 /* PUT THIS INTO COMMAND LINE (assuming you are in the parent directory as this file)
 
-    g++ -std=c++17 -I./include src/main.cpp -o main -lstdc++fs -O3
+    g++ -std=c++17 -I./include src/main.cpp -o main -lstdc++fs -O3 -pthread -fopenmp
     ./main --L 24 --M 5 --z 3.6 --lat square
+    ./main --L 24 --M 5 --z 3.6 --lat square --equilibrate --target-error 0.005   (adaptive burn-in and run length)
+    ./main --L 24 --M 5 --z 3.6 --lat square --run 1 --replicas 70 --threads 16     (runs 1..70 sharing one lattice)
+    ./main --L 256 --M 5 --z 3.6 --lat square --kernel checkerboard --threads 32     (one large run on all cores)
+    ./main --L 48 --M 7 --z 6.0 --lat square --kernel bkl     (rejection-free, for the dense phase)
+    ./main --L 48 --M 5 --z 3.6 --lat square --cluster-sweep-every 1     (every cluster recolored after each sweep)
+    ./main --L 1024 --M 5 --z 3.6 --lat square --packed     (half a byte per site)
+    ./main --L 64 --M 5 --z 3.6 --lat square --cluster-stats-every 10     (cluster sizes and percolation)
+    g++ -std=c++17 -I./include src/main.cpp -o main -lstdc++fs -O3 -pthread -fopenmp -DWR_STATS     (move counters and phase timers, see sim/sweep_stats.h)
+    ./main --L 48 --M 5 --lat hexagonal --z-grid 5.42 5.44 5.46 5.48 5.50 --threads 5   (parallel tempering)
 
 */
 
-// seeding random number generator (Philox)
-
-std::random_device rd;
-uint64_t seed = (static_cast<uint64_t>(rd()) << 32) | static_cast<uint64_t>(rd());
-openrand::Philox rng(seed, 0);
-
-int roundDownToNearestTen(double value) {
-    return std::floor(value / 10.0)*10.0;
-}
-
-/////////////
-
-/*
-
-* Citation:
-* Wicaksono, J. K. (2025). Greedy vs Backtracking: A comparative study of
-* graph vertex coloring algorithms with C++ implementations. Makalah
-* IF1220 Matematika Diskrit, Institut Teknologi Bandung.
-
-*/
-
-using Graph = vector<vector<int>>;
-
-bool isSafe(int v, int c, const Graph &G, const vector<int> &color) {
-    for (int u : G[v]) {
-        if (color[u] == c)
-            return false;
-    }
-    return true;
-}
-
-bool colorVertex(int v, const Graph &G, vector<int> &color, int k, int n) {
-    if (v == n)
-        return true;
-
-    for (int c = 1; c <= k; ++c) {
-        if (isSafe(v, c, G, color)) {
-            color[v] = c;
-            if (colorVertex(v + 1, G, color, k, n)) {
-                return true;
-            }
-            color[v] = 0; // Backtrack
-        }
-    }
-    return false;
-}
-
-vector<int> backtrackGraphColoring(const Graph &G, int k, int n) {
-    vector<int> color(n, 0); // 0-based indexing
-
-    if (colorVertex(0, G, color, k, n)) {
-        return color;
-    } else {
-        return {}; // No valid coloring
-    }
-}
-
-bool isBipartite(const std::vector<std::vector<int>>& adj) {
-    int n = adj.size();
-    std::vector<int> color(n, -1);  // -1 = uncolored, 0 and 1 are the two colors
-
-    for (int start = 0; start < n; ++start) {
-        if (color[start] != -1) continue;  // already visited in another component
-
-        // BFS from this component
-        std::queue<int> q;
-        color[start] = 0;
-        q.push(start);
-
-        while (!q.empty()) {
-            int u = q.front(); q.pop();
-            for (int v : adj[u]) {
-                if (color[v] == -1) {
-                    // assign opposite color to neighbor
-                    color[v] = color[u] ^ 1;
-                    q.push(v);
-                }
-                else if (color[v] == color[u]) {
-                    // found same-color neighbor → not bipartite
-                    return false;
-                }
-            }
-        }
-    }
-
-    return true;
-}
-
-std::vector<int> clusterFinder(const std::vector<int>& nodes, const std::vector<std::vector<int>>& adj, int start) {
-
-    std::vector<bool> visited(nodes.size(), false);
-    std::queue<int> q;
-    std::vector<int> cluster_vertices;
-
-    const int target_value = nodes[start];
-
-    visited[start] = true;
-    q.push(start);
-    cluster_vertices.push_back(start);
-
-    while (!q.empty()) {
-        int u = q.front();
-        q.pop();
-
-        for (int v : adj[u]) {
-            if (!visited[v] && nodes[v] == target_value) {
-                visited[v] = true;
-                q.push(v);
-                cluster_vertices.push_back(v);
-            }
-        }
-    }
-
-    return cluster_vertices;
-}
-
-std::vector<double> sublattice_densities(std::vector<int> nodes, std::vector<int> sublattice_locations) {
-    int k = *std::max_element(sublattice_locations.begin(), sublattice_locations.end()); // size of rho array
-
-    vector<double> arr;
-    
-    for (int i = 1; i <= k; i++) {
-        int sub_tot = std::count(sublattice_locations.begin(), sublattice_locations.end(), i);
-        double rho = 0;
-        for (int j = 0; j < nodes.size(); j++) {
-            if (sublattice_locations[j] == i && nodes[j] != 0) {
-                rho++;
-            }
-        }
-        rho /= sub_tot;
-        arr.push_back(rho);
-    }
-
-    return arr;
-
-}
-
-double stdev(std::vector<double> arr, int n) {
-    double sum = 0.0;
-    for (int i = 0; i < n; i++) {
-        sum += arr[i];
-    }
-    double mean = sum / n;
-
-    double sqSum = 0.0;
-    for (int i = 0; i < n; i++) {
-        double diff = arr[i] - mean;
-        sqSum += diff * diff;
-    }
-
-    return std::sqrt(sqSum / (n));
-}
-
-double crystalParameterTest(std::vector<int> nodes, std::vector<int> sublattice_locations) {
-    std::vector<double> arr = sublattice_densities(nodes, sublattice_locations);
-    int k = arr.size();
-
-    return (k / std::sqrt(k-1)) * stdev(arr, k);
-}
-
-double crystalParameter(std::vector<int> nodes, std::vector<int> sublattice_locations) {
-    /*
-    double c = 0;
-    for (int i = 0; i < nodes.size(); i++) {
-        if (sublattice_locations[i] == 1) {
-            if (nodes[i] != 0) {
-                c++;
-            }
-            else {
-                c--;
-            }
-        }
-        if (sublattice_locations[i] == 2) {
-            if (nodes[i] != 0) {
-                c--;
-            }
-            else {
-                c++;
-            }
-        }
-    }
-    c /= nodes.size();
-    return std::abs(c);
-    */
-
-    std::vector<double> arr = sublattice_densities(nodes, sublattice_locations);
-    int k = arr.size();
-
-    return (k / std::sqrt(k-1)) * stdev(arr, k);
-
-}
-
-void visLattice(
-    const std::vector<int>& node_values,
-    const std::vector<std::vector<int>>& adjacency_list
-) {
-    int n_nodes = node_values.size();
-    int N = static_cast<int>(std::sqrt(n_nodes));
-
-    if (N * N != n_nodes) {
-        throw std::runtime_error("Node count is not a perfect square.");
-    }
-
-    if (adjacency_list.size() != node_values.size()) {
-        throw std::runtime_error("Adjacency list size mismatch.");
-    }
-
-    auto color_code = [](int v) -> std::string {
-        switch (v) {
-            case 0:  return "\033[40m";   // black
-            case 1:  return "\033[41m";   // red
-            case 2:  return "\033[42m";   // green
-            case 3:  return "\033[43m";   // yellow
-            case 4:  return "\033[44m";   // blue
-            case 5:  return "\033[45m";   // magenta
-            case 6:  return "\033[46m";   // cyan
-            case 7:  return "\033[47m";   // white
-            case 8:  return "\033[100m";  // bright black (gray)
-            case 9:  return "\033[101m";  // bright red
-            case 10: return "\033[102m";  // bright green
-            case 11: return "\033[103m";  // bright yellow
-            case 12: return "\033[104m";  // bright blue
-            case 13: return "\033[105m";  // bright magenta
-            case 14: return "\033[106m";  // bright cyan
-            case 15: return "\033[107m";  // bright white
-            default: throw std::runtime_error("Invalid node value (must be 0–15)");
-        }
-    };
-
-    const std::string reset = "\033[0m";
-
-    for (int r = 0; r < N; r++) {
-        for (int c = 0; c < N; c++) {
-            int idx = r * N + c;
-            std::cout << color_code(node_values[idx]) << "  " << reset;
-        }
-        std::cout << "\n";
-    }
-}
-
-
-double density(std::vector<int> nodes) {
-    int count = 0;
-    for (int n : nodes) {
-        if (n != 0) {
-            count++;
+// z as it appears in file names, e.g. 3.6 -> "3-600"
+std::string formatZ(double z) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3) << z;
+    std::string str_z = oss.str();
+    for (char &c : str_z) {
+        if (c == '.') {
+            c = '-';
         }
     }
-    return double(count) / nodes.size();
-}
-
-double demixedParameter(std::vector<int> nodes, int M) {
-   std::complex<double> total = std::complex<double>(0, 0);
-    for (int i = 1; i <= M; i++) {
-        double angle = 2 * M_PI * (i - 1)/M;
-        std::complex<double> euler = std::exp(std::complex<double>(0, -1 * angle));
-        auto N_i = std::count(nodes.begin(), nodes.end(), i);
-        double m_i = static_cast<double>(N_i) / (density(nodes) * nodes.size());
-        total += (m_i * euler);
-    }
-    return std::abs(total);
+    return str_z;
 }
 
-int randInt(int x, int y) {
-    std::uniform_int_distribution<int> dist(x, y);
-    int a = dist(rng);  // y ∼ Uniform{a,…,b}   
-
-    return a;
-}
-
-int randIntWithoutVal(int x, int y, int val) {
-    std::uniform_int_distribution<int> dist(x, y);
-    int a = dist(rng);  // y ∼ Uniform{a,…,b}   
-
-    while (a == val) {
-        a = dist(rng);
-    }
-    return a;
+// Philox key of replica r in --replicas mode: the base seed itself for r = 0 (so a single run
+// is unchanged), splitmix64 of (seed, r) otherwise
+uint64_t replicaSeed(uint64_t seed, int r) {
+    if (r == 0) return seed;
+    uint64_t x = seed + 0x9E3779B97F4A7C15ULL * static_cast<uint64_t>(r);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
 }
 
 struct Color {
     int r, g, b;
 };
 
-void generateLatticeImage(const std::vector<int>& nodes, const std::vector<std::vector<int>>& adj, const std::string& filename) {
+template <typename Sites>
+void generateLatticeImage(const Sites& nodes, const LatticeGraph& adj, const std::string& filename) {
     if (nodes.empty()) {
         std::cerr << "Error: Node vector is empty." << std::endl;
         return;
@@ -404,169 +203,197 @@ void generateLatticeImage(const std::vector<int>& nodes, const std::vector<std::
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int main(int argc, char* argv[]) {
-    MyArgs args = argparse::parse<MyArgs>(argc, argv);
-
+// One independent Markov chain (one `run`): its own nodes, rng stream, time series, summary and
+// checkpoint, on a lattice that may be shared read-only with other replicas. seed = 0 draws one
+// from std::random_device. Returns the exit code for main.
+template <typename Sites>
+int simulate(const MyArgs& args, const LatticeData& lattice, const std::string& str_z, int run, uint64_t seed, int n_threads) {
     int L = args.L;
     int M = args.M;
     double z = args.z;
-    string lat = args.lat;
-    int run = args.run;
-    
-    int sweeps = 1000000; // will be modified during runtime when equilibrium point is reached
 
-    int k = 0; // number of colors (or sublattices) in lattice graph, will be set to 2 or 3 depending on the k-partiteness of the lattice
+    int sweeps = args.sweeps; // upper bound, --target-error may end the run earlier
 
-    if (L <= 0 || M <= 0 || z <= 0) {
-        std::cerr << "Error: All parameters must be positive values." << std::endl;
-        return 1;
-    }
+    std::string run_tag = "L" + std::to_string(L) + "_M" + std::to_string(M) + "_z" + str_z + "_" + args.lat + "_run" + std::to_string(run);
 
-    std::ostringstream oss;
-    oss.str("");
-    oss << std::fixed << std::setprecision(3) << z;
-    std::string str_z = oss.str();
-    std::string str_z_noformat = str_z; 
-    
-    
-    for (char &c : str_z) {
-        if (c == '.') {
-            c = '-';
+    // state of an interrupted run (nodes, rng counter, sweep, accumulators), see sim/checkpoint.h
+    std::string checkpoint_filename = "data/checkpoints/checkpoint_" + run_tag + ".bin";
+
+    std::unique_ptr<CheckpointState> restart;
+    if (args.resume && std::filesystem::exists(checkpoint_filename)) {
+        try {
+            restart = std::make_unique<CheckpointState>(readCheckpoint(checkpoint_filename));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        if (restart->info.L != L || restart->info.M != M || restart->info.z != z
+            || restart->info.lat != args.lat || restart->info.run != run
+            || restart->moments.size() != 3 || restart->moments[0].blockLength() != static_cast<uint64_t>(args.block)
+            || restart->detectors.size() != (args.equilibrate ? 3u : 0u)) {
+            std::cerr << "Error: " << checkpoint_filename << " was written with different parameters." << std::endl;
+            return 1;
         }
     }
 
-    std::string cp_filename = "data/sampling/crystal/crystal_L" + std::to_string(L) + "_M" + std::to_string(M) + "_z" + str_z + "_" + args.lat + "_run" + std::to_string(run) + ".txt";
-    std::string dp_filename = "data/sampling/demixed/demixed_L" + std::to_string(L) + "_M" + std::to_string(M) + "_z" + str_z + "_" + args.lat + "_run" + std::to_string(run) + ".txt";
-    std::string de_filename = "data/sampling/density/density_L" + std::to_string(L) + "_M" + std::to_string(M) + "_z" + str_z + "_" + args.lat + "_run" + std::to_string(run) + ".txt";
-
-    // opening data files
-    std::ofstream cp_data(cp_filename.c_str());
-    std::ofstream dp_data(dp_filename.c_str());
-    std::ofstream de_data(de_filename.c_str());
-    
-    std::vector<std::vector<int>> lattice_adjacency_list;
-
-    std::string adj_data_file = "src/lattice/adj-lists/adj_list_" + std::to_string(L) + "_" + args.lat + ".txt";
-    std::ifstream file(adj_data_file);
-
-    if (!file) {
-        std::cerr << "Missing adjacency list: " << adj_data_file
-                  << " (run Row action `generate_lattice` first)" << std::endl;
-        return 1;
+    // seeding random number generator (Philox); a resumed run keeps its original seed
+    if (restart) seed = restart->info.seed;
+    if (seed == 0) {
+        std::random_device rd;
+        seed = (static_cast<uint64_t>(rd()) << 32) | static_cast<uint64_t>(rd());
     }
-
-    string line;
-
-    while (std::getline(file, line)) {
-        // turn “[”, “]”, “,” into plain spaces:
-        for (char& c : line) {
-            if (c=='[' || c==']' || c==',') c = ' ';
+    RandomStream rng(seed);
+
+    // one binary file per run, all observables of a sweep in one record (read with src/actions/timeseries_io.py)
+    std::string series_filename = "data/sampling/series/series_" + run_tag + ".bin";
+
+    TimeSeriesInfo series_info;
+    series_info.L = L;
+    series_info.M = M;
+    series_info.z = z;
+    series_info.lat = args.lat;
+    series_info.run = run;
+    series_info.seed = seed;
+    series_info.stride = 1;
+
+    std::unique_ptr<TimeSeriesWriter> series;
+    if (!args.no_series) {
+        try {
+            if (restart) {
+                series = std::make_unique<TimeSeriesWriter>(series_filename, series_info, restart->series_records);
+            } else {
+                series = std::make_unique<TimeSeriesWriter>(series_filename, series_info, std::vector<std::string>{"crystal", "demixed", "density"}, args.float64);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
         }
+    }
 
-        std::istringstream iss(line);
-        std::vector<int> adj_list_push_back;
-
-        int neighbor;
-        while (iss >> neighbor) {
-            adj_list_push_back.push_back(neighbor);
+    // power sums and block statistics after burn-in (read with timeseries_io.load_summary)
+    std::string summary_filename = "data/sampling/summary/summary_" + run_tag + ".json";
+
+    MomentAccumulator cp_moments(args.block);
+    MomentAccumulator dp_moments(args.block);
+    MomentAccumulator de_moments(args.block);
+
+    // end of the burn-in: fixed, or found by MSER on each observable (sim/equilibration.h)
+    uint64_t burn_in = args.burn_in;
+    bool equilibrated = !args.equilibrate;
+    bool finished = false;
+    std::vector<EquilibrationDetector> detectors(args.equilibrate ? 3 : 0);
+
+    const uint64_t min_blocks = 20; // before trusting the block error for --target-error
+
+    // samples and order-parameter power sums per particle number, for reweighting in z
+    std::string histogram_filename = "data/sampling/histogram/histogram_" + run_tag + ".bin";
+    ParticleHistogram histogram(lattice.graph.size());
+
+    // cluster-size histogram, largest cluster and percolation, see sim/cluster_stats.h
+    std::string cluster_stats_filename = "data/sampling/clusters/clusters_" + run_tag + ".bin";
+    ClusterStatistics cluster_stats(args.cluster_stats_every > 0 ? lattice.graph.size() : 0);
+
+    if (restart) {
+        cp_moments = restart->moments[0];
+        dp_moments = restart->moments[1];
+        de_moments = restart->moments[2];
+        burn_in = restart->burn_in;
+        equilibrated = restart->equilibrated;
+        finished = restart->finished;
+        detectors = restart->detectors;
+        if (restart->histogram.size() != histogram.bins().size()) {
+            std::cerr << "Error: " << checkpoint_filename << " does not match the lattice size." << std::endl;
+            return 1;
         }
-
-        lattice_adjacency_list.push_back(adj_list_push_back);
+        histogram.bins() = restart->histogram;
+        if (restart->clusters.counts().size() != cluster_stats.counts().size()) {
+            std::cerr << "Error: " << checkpoint_filename << " was written with a different --cluster-stats-every." << std::endl;
+            return 1;
+        }
+        cluster_stats = restart->clusters;
     }
+    
+    const LatticeGraph& lattice_adjacency_list = lattice.graph;
+    int k = lattice.n_sublattices; // number of colors (or sublattices), 2 or 3 depending on the k-partiteness of the lattice
 
+    Sites nodes(lattice_adjacency_list.size(), 0);
+    const std::vector<int>& sublattice_locations = lattice.sublattice;
 
-    if (isBipartite(lattice_adjacency_list)) {
-        k = 2;
-    } else {
-        k = 3;
-    }
+    ClusterSearch cluster_search(nodes.size()); // reused by every cluster move
+    ClusterLabels clusters(nodes.size());       // and by the full cluster sweeps
 
-    std::vector<int> nodes(lattice_adjacency_list.size(), 0);
-    std::vector<int> sublattice_locations = backtrackGraphColoring(lattice_adjacency_list, k, lattice_adjacency_list.size());
+    int s = 1; // start at sweep 1
 
-    std::bernoulli_distribution bernoulli_trial((M*z)/((M*z)+1));
-    
-    for (int i = 0; i < nodes.size(); i++) {
-        bool success = bernoulli_trial(rng);
-        if (success == false) { // if bernoulli probability outcomes false, make lattice(i,j) empty (0)
-            continue; // move to next iteration
-        }
-        else {
-            int k = randInt(1, M); // generate species (k = 1, 2, 3, ... , M)
-            bool conflict = false;
-            for (int j = 0; j < lattice_adjacency_list[i].size(); j++) {
-                int index = lattice_adjacency_list[i][j];
-                if (k != nodes[index] && nodes[index] != 0) {
-                    conflict = true;
-                    break;
-                }
-            }
-            if (conflict == false) {
-                nodes[i] = k;
-            }
-            else {
-                nodes[i] = 0;
-            }
+    if (restart) {
+        if (restart->nodes.size() != nodes.size()) {
+            std::cerr << "Error: " << checkpoint_filename << " does not match the lattice size." << std::endl;
+            return 1;
         }
+        loadSites(nodes, restart->nodes);
+        rng.seek(restart->rng_counter);
+        s = restart->sweep;
+    }
+    else {
+        randomFill(nodes, lattice_adjacency_list, rng, M, z);
     }
     
-    int s = 1; // start at sweep 1
-    int c = 1;
-
-    double p = 0.95;
-
-    std::bernoulli_distribution p_remove(p); // for cluster flipping
-    std::bernoulli_distribution A_remove(std::min(1.0, (1.0/(z*M*p))));
-    std::bernoulli_distribution A_insert(std::min(1.0, (z*M*p)));
+    // per-species and per-sublattice counts, updated by every move below
+    ObservableTracker observables(M, k, sublattice_locations);
+    observables.rebuild(nodes);
+
+    MoveRates rates(z, M);
+
+    // checkerboard kernel: sites grouped by sublattice label (index 0 unused)
+    const bool checkerboard = args.kernel == "checkerboard";
+    std::vector<std::vector<int>> sublattice_sites;
+    std::vector<int> recolor_shift;
+    if (checkerboard) {
+        sublattice_sites.resize(k + 1);
+        for (int i = 0; i < nodes.size(); i++) {
+            sublattice_sites[sublattice_locations[i]].push_back(i);
+        }
+        recolor_shift.assign(nodes.size(), 0);
+    }
 
-    while (s <= sweeps) {
-        for (int m = 0; m < nodes.size(); m++) {
-            int i = randInt(0, nodes.size()-1); // Choose a site at random
-            int k = randInt(1, M);              // Choose a color at random
+    // bkl kernel: its class lists are rebuilt from the nodes, so checkpoints need nothing extra
+    std::unique_ptr<NFoldEngine<Sites>> nfold;
+    if (args.kernel == "bkl") {
+        nfold = std::make_unique<NFoldEngine<Sites>>(lattice_adjacency_list, M, z);
+        nfold->rebuild(nodes);
+    }
 
-            if (nodes[i] != 0) {
-                if (p_remove(rng)) {
-                    if (A_remove(rng)) {
-                        nodes[i] = 0;
-                    }
-                    else {
-                        continue;
-                    }
-                }
-                else {
-                    std::vector<int> cluster = clusterFinder(nodes, lattice_adjacency_list, i);
+    // move counters and phase timers of a -DWR_STATS build (sim/sweep_stats.h), otherwise no-ops
+    std::string stats_filename = "data/sampling/stats/stats_" + run_tag + ".json";
+    SweepStats stats(args.kernel);
+    const int first_sweep = s;
 
-                    int col = randIntWithoutVal(1, M, nodes[i]);
-                    for (int v : cluster) { 
-                        nodes[v] = col;
-                    }
-                }
-            }
-            else {
-                if (A_insert(rng)) {
-                    bool conflict = false;
-                        for (int j = 0; j < lattice_adjacency_list[i].size(); j++) {
-                            int index = lattice_adjacency_list[i][j];
-                            if (k != nodes[index] && nodes[index] != 0) {
-                                conflict = true;
-                                break;
-                            }
-                        }
-
-                    if (conflict == false) {
-                        nodes[i] = k;
-                    }
-                    else {
-                        continue;
-                    }
+    while (s <= sweeps && !finished) {
+        stats.lap(PHASE_IO);
+        if (nfold) {
+            nfold->sweep(nodes, observables, rng);
+        }
+        else {
+            withDegree(lattice_adjacency_list, [&](auto degree) {
+                if (checkerboard) {
+                    sweepCheckerboard<degree>(nodes, lattice_adjacency_list, sublattice_sites, observables, cluster_search,
+                                              recolor_shift, seed, s, M, z, n_threads);
                 }
                 else {
-                    continue;
+                    sweep<degree>(nodes, lattice_adjacency_list, observables, cluster_search, rates, rng, M, stats);
                 }
-            }
+            });
+        }
+        stats.lap(PHASE_SWEEP);
 
+        if (args.cluster_sweep_every > 0 && s % args.cluster_sweep_every == 0) {
+            recolorClusters(nodes, lattice_adjacency_list, clusters, observables, rng, M);
+            stats.clusterSweep(clusters.count());
+            if (nfold) {
+                nfold->rebuild(nodes);
+            }
         }
-        
+        stats.lap(PHASE_CLUSTER_SWEEP);
+
         /*
         if (s % 100 == 0) {
             std::string folder = "data/movies/M" + std::to_string(M) + "/z" + str_z;
@@ -586,20 +413,415 @@ int main(int argc, char* argv[]) {
         }
         */
 
-        double cp = crystalParameter(nodes, sublattice_locations);
-        double de = density(nodes);
-        double dp = demixedParameter(nodes, M);
+        double cp = observables.crystal();
+        double de = observables.density();
+        double dp = observables.demixed();
+        stats.lap(PHASE_MEASURE);
+
+        if (series) {
+            series->append({cp, dp, de});
+        }
+        stats.lap(PHASE_IO);
+
+        if (!equilibrated) {
+            detectors[0].add(cp);
+            detectors[1].add(dp);
+            if (detectors[2].add(de) && s >= args.burn_in
+                && detectors[0].equilibrated() && detectors[1].equilibrated() && detectors[2].equilibrated()) {
+                equilibrated = true;
+                burn_in = s;
+            }
+        }
+        else if (s > burn_in) {
+            cp_moments.add(cp);
+            dp_moments.add(dp);
+            de_moments.add(de);
+            histogram.add(observables.occupied(), cp, dp);
+            if (args.cluster_stats_every > 0 && s % args.cluster_stats_every == 0) {
+                cluster_stats.measure(nodes, lattice_adjacency_list, clusters, L);
+            }
+
+            if (args.target_error > 0 && dp_moments.samples() % args.block == 0
+                && dp_moments.blockBinders().n >= min_blocks && dp_moments.blockBinders().error() <= args.target_error) {
+                finished = true;
+            }
+        }
+        stats.lap(PHASE_MEASURE);
+
+        // also at the last sweep, so resuming a finished run only rewrites its summary
+        if (args.checkpoint_every > 0 && (s % args.checkpoint_every == 0 || s == sweeps || finished)) {
+            // the series is synced first, so the checkpoint never points past data on disk
+            CheckpointState state;
+            state.info = series_info;
+            state.rng_counter = rng.position();
+            state.sweep = s + 1;
+            state.burn_in = burn_in;
+            state.equilibrated = equilibrated;
+            state.finished = finished;
+            state.nodes = unpackSites(nodes);
+            state.moments = {cp_moments, dp_moments, de_moments};
+            state.histogram = histogram.bins();
+            state.detectors = detectors;
+            state.clusters = cluster_stats;
+            try {
+                if (series) {
+                    series->sync();
+                    state.series_records = series->records();
+                }
+                if (args.cluster_stats_every > 0) {
+                    writeClusterStats(cluster_stats_filename, series_info, args.cluster_stats_every, cluster_stats);
+                }
+                writeCheckpoint(checkpoint_filename, state);
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: " << e.what() << std::endl;
+            }
+
+            // a resumed run starts from freshly built class lists; match their order here
+            if (nfold) {
+                nfold->rebuild(nodes);
+            }
+        }
 
-        cp_data << cp << std::endl;
-        dp_data << dp << std::endl;
-        de_data << de << std::endl;
+#ifdef WR_STATS
+        if (args.stats_every > 0 && (s - first_sweep + 1) % args.stats_every == 0) {
+            try {
+                stats.write(stats_filename, series_info, s - first_sweep + 1);
+            } catch (const std::exception& e) {
+                std::cerr << "Warning: " << e.what() << std::endl;
+            }
+        }
+#endif
 
         s++;
     }
 
-    cp_data.close();
-    dp_data.close();
-    de_data.close();  
+    if (series) {
+        series->close();
+    }
+
+    if (!equilibrated) {
+        std::cerr << "Warning: not equilibrated after " << s - 1 << " sweeps, no moments accumulated." << std::endl;
+        burn_in = s - 1;
+    }
+
+    try {
+        writeSummaryJson(summary_filename, series_info, s - 1, burn_in,
+                         {{"crystal", &cp_moments}, {"demixed", &dp_moments}, {"density", &de_moments}});
+        writeHistogram(histogram_filename, series_info, histogram);
+        if (args.cluster_stats_every > 0) {
+            writeClusterStats(cluster_stats_filename, series_info, args.cluster_stats_every, cluster_stats);
+        }
+        if (SweepStats::enabled) {
+            stats.lap(PHASE_IO);
+            stats.write(stats_filename, series_info, s - first_sweep);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
 
     return 0;
 }
+
+// Parallel tempering: one chain per fugacity of --z-grid, with Metropolis swaps of neighboring
+// configurations every --swap-every sweeps (see sim/tempering.h). Each z writes the same series
+// and summary files an independent run at that z would, plus one tempering_<...>.json with the
+// swap acceptance rates and round trips. Fixed burn-in only, and no checkpoints.
+template <typename Sites>
+int temper(const MyArgs& args, const LatticeData& lattice) {
+    int L = args.L;
+    int M = args.M;
+    int run = args.run;
+    int sweeps = args.sweeps;
+
+    std::vector<double> zs = args.z_grid;
+    std::sort(zs.begin(), zs.end());
+    const int n = zs.size();
+
+    if (zs.front() <= 0 || std::adjacent_find(zs.begin(), zs.end()) != zs.end() || args.swap_every <= 0) {
+        std::cerr << "Error: --z-grid needs distinct positive fugacities and --swap-every must be positive." << std::endl;
+        return 1;
+    }
+    if (args.resume || args.equilibrate || args.target_error > 0 || args.replicas != 1 || args.kernel != "random") {
+        std::cerr << "Error: --z-grid does not support --resume, --equilibrate, --target-error, --replicas or --kernel." << std::endl;
+        return 1;
+    }
+
+    uint64_t seed = args.seed;
+    if (seed == 0) {
+        std::random_device rd;
+        seed = (static_cast<uint64_t>(rd()) << 32) | static_cast<uint64_t>(rd());
+    }
+
+    const LatticeGraph& lattice_adjacency_list = lattice.graph;
+    const int k = lattice.n_sublattices;
+
+    // per slot (fixed z): rng stream, move rates, outputs; the configurations move between slots
+    std::vector<RandomStream> rngs;
+    std::vector<MoveRates> rates;
+    std::vector<ClusterSearch> cluster_search;
+    std::vector<ClusterLabels> clusters;
+    std::vector<Sites> nodes(n, Sites(lattice_adjacency_list.size(), 0));
+    std::vector<ObservableTracker> observables;
+    std::vector<TimeSeriesInfo> infos(n);
+    std::vector<std::unique_ptr<TimeSeriesWriter>> series(n);
+    std::vector<MomentAccumulator> cp_moments(n, MomentAccumulator(args.block));
+    std::vector<MomentAccumulator> dp_moments(n, MomentAccumulator(args.block));
+    std::vector<MomentAccumulator> de_moments(n, MomentAccumulator(args.block));
+    std::vector<ParticleHistogram> histograms(n, ParticleHistogram(lattice_adjacency_list.size()));
+    std::vector<ClusterStatistics> cluster_stats(n, ClusterStatistics(args.cluster_stats_every > 0 ? lattice_adjacency_list.size() : 0));
+
+    rngs.reserve(n);
+    cluster_search.reserve(n);
+    for (int i = 0; i < n; i++) {
+        rngs.emplace_back(replicaSeed(seed, i));
+        rates.emplace_back(zs[i], M);
+        cluster_search.emplace_back(lattice_adjacency_list.size());
+        clusters.emplace_back(lattice_adjacency_list.size());
+
+        randomFill(nodes[i], lattice_adjacency_list, rngs[i], M, zs[i]);
+        observables.emplace_back(M, k, lattice.sublattice);
+        observables[i].rebuild(nodes[i]);
+
+        infos[i].L = L;
+        infos[i].M = M;
+        infos[i].z = zs[i];
+        infos[i].lat = args.lat;
+        infos[i].run = run;
+        infos[i].seed = replicaSeed(seed, i);
+        infos[i].stride = 1;
+
+        if (!args.no_series) {
+            std::string series_filename = "data/sampling/series/series_L" + std::to_string(L) + "_M" + std::to_string(M) + "_z" + formatZ(zs[i]) + "_" + args.lat + "_run" + std::to_string(run) + ".bin";
+            try {
+                series[i] = std::make_unique<TimeSeriesWriter>(series_filename, infos[i], std::vector<std::string>{"crystal", "demixed", "density"}, args.float64);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // swap decisions get their own stream (counter 1 instead of 0 under the base key)
+    RandomStream swap_rng(seed, 1);
+    TemperingStats stats(n);
+
+    int n_threads = args.threads > 0 ? args.threads : std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::min(n_threads, n);
+
+    // sweeps s0+1 .. s1 of the slots of thread t
+    auto advance = [&](int t, int s0, int s1) {
+        for (int i = t; i < n; i += n_threads) {
+            for (int s = s0 + 1; s <= s1; s++) {
+                withDegree(lattice_adjacency_list, [&](auto degree) {
+                    sweep<degree>(nodes[i], lattice_adjacency_list, observables[i], cluster_search[i], rates[i], rngs[i], M);
+                });
+                if (args.cluster_sweep_every > 0 && s % args.cluster_sweep_every == 0) {
+                    recolorClusters(nodes[i], lattice_adjacency_list, clusters[i], observables[i], rngs[i], M);
+                }
+
+                double cp = observables[i].crystal();
+                double de = observables[i].density();
+                double dp = observables[i].demixed();
+
+                if (series[i]) {
+                    series[i]->append({cp, dp, de});
+                }
+                if (s > args.burn_in) {
+                    cp_moments[i].add(cp);
+                    dp_moments[i].add(dp);
+                    de_moments[i].add(de);
+                    histograms[i].add(observables[i].occupied(), cp, dp);
+                    if (args.cluster_stats_every > 0 && s % args.cluster_stats_every == 0) {
+                        cluster_stats[i].measure(nodes[i], lattice_adjacency_list, clusters[i], L);
+                    }
+                }
+            }
+        }
+    };
+
+    // swaps after sweep s; only thread 0 runs them, while the others wait at the barrier
+    auto exchange = [&](int s) {
+        // alternate even and odd pairs so every pair is tried every other exchange
+        for (int i = (s / args.swap_every) % 2; i + 1 < n; i += 2) {
+            long long N_a = observables[i].occupied();
+            long long N_b = observables[i + 1].occupied();
+            double accept = std::min(1.0, std::pow(zs[i] / zs[i + 1], static_cast<double>(N_b - N_a)));
+            bool swapped = swap_rng.uniform() < accept;
+            if (swapped) {
+                std::swap(nodes[i], nodes[i + 1]);
+                std::swap(observables[i], observables[i + 1]);
+            }
+            stats.recordSwap(i, swapped);
+        }
+        stats.update(s);
+    };
+
+    // one worker per thread for the whole run; every thread walks the same intervals and
+    // meets the others at the barrier after its sweeps and again after the swaps
+    PhaseBarrier barrier(n_threads);
+    auto work = [&](int t) {
+        for (int s = 0; s < sweeps; ) {
+            int next = std::min(sweeps, s + args.swap_every);
+            advance(t, s, next);
+            s = next;
+
+            if (s % args.swap_every != 0) continue;    // last, partial interval
+
+            barrier.wait();
+            if (t == 0) {
+                exchange(s);
+            }
+            barrier.wait();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < n_threads; t++) {
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    int status = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (series[i]) {
+            series[i]->close();
+        }
+
+        std::string run_tag = "L" + std::to_string(L) + "_M" + std::to_string(M) + "_z" + formatZ(zs[i]) + "_" + args.lat + "_run" + std::to_string(run);
+        try {
+            writeSummaryJson("data/sampling/summary/summary_" + run_tag + ".json", infos[i], sweeps, args.burn_in,
+                             {{"crystal", &cp_moments[i]}, {"demixed", &dp_moments[i]}, {"density", &de_moments[i]}});
+            writeHistogram("data/sampling/histogram/histogram_" + run_tag + ".bin", infos[i], histograms[i]);
+            if (args.cluster_stats_every > 0) {
+                writeClusterStats("data/sampling/clusters/clusters_" + run_tag + ".bin", infos[i], args.cluster_stats_every, cluster_stats[i]);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            status = 1;
+        }
+    }
+
+    std::string tempering_filename = "data/sampling/tempering/tempering_L" + std::to_string(L) + "_M" + std::to_string(M) + "_" + args.lat + "_run" + std::to_string(run) + ".json";
+    try {
+        stats.writeJson(tempering_filename, zs, sweeps, args.swap_every);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        status = 1;
+    }
+
+    for (int i = 0; i + 1 < n; i++) {
+        std::cout << "swap z " << zs[i] << " <-> " << zs[i + 1] << ": acceptance " << stats.acceptance(i) << std::endl;
+    }
+    std::cout << "round trips: " << stats.roundTrips() << ", mean " << stats.meanRoundTrip() << " sweeps" << std::endl;
+
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    MyArgs args = argparse::parse<MyArgs>(argc, argv);
+
+    int L = args.L;
+    int M = args.M;
+    double z = args.z;
+    string lat = args.lat;
+
+    if (L <= 0 || M <= 0 || (z <= 0 && args.z_grid.empty())) {
+        std::cerr << "Error: All parameters must be positive values." << std::endl;
+        return 1;
+    }
+
+    if (args.sweeps <= 0 || args.block <= 0 || args.burn_in < 0 || args.checkpoint_every < 0 || args.target_error < 0
+        || args.cluster_sweep_every < 0 || args.cluster_stats_every < 0) {
+        std::cerr << "Error: --sweeps and --block must be positive, --burn-in, --checkpoint-every, --target-error, --cluster-sweep-every and --cluster-stats-every non-negative." << std::endl;
+        return 1;
+    }
+
+#ifdef WR_STATS
+    if (args.stats_every < 0) {
+        std::cerr << "Error: --stats-every must be non-negative." << std::endl;
+        return 1;
+    }
+#endif
+
+    if (args.replicas <= 0 || args.threads < 0) {
+        std::cerr << "Error: --replicas must be positive and --threads non-negative." << std::endl;
+        return 1;
+    }
+
+    if (args.kernel != "random" && args.kernel != "checkerboard" && args.kernel != "bkl") {
+        std::cerr << "Error: --kernel must be random, checkerboard or bkl." << std::endl;
+        return 1;
+    }
+
+    // sites are stored as bytes or nibbles; checkerboard threads write neighboring sites, which
+    // may share a byte when packed
+    if (M > (args.packed ? 15 : 255) || (args.packed && args.kernel == "checkerboard")) {
+        std::cerr << "Error: M must be at most 255 (15 with --packed), and --packed does not support the checkerboard kernel." << std::endl;
+        return 1;
+    }
+
+    std::string str_z = formatZ(z);
+
+    // binary cache (adj_list_<L>_<lat>.bin) if present, otherwise generated natively (or read
+    // from the text list for lattice types arch_lattices.h does not know) and then cached
+    LatticeData lattice;
+
+    try {
+        lattice = loadLattice("src/lattice/adj-lists", L, args.lat);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << " (run Row action `generate_lattice` first)" << std::endl;
+        return 1;
+    }
+
+    if (!args.z_grid.empty()) {
+        return args.packed ? temper<PackedSites>(args, lattice) : temper<ByteSites>(args, lattice);
+    }
+
+    if (args.replicas == 1) {
+        // a single run gives all threads to the checkerboard kernel
+        int n_threads = args.threads > 0 ? args.threads : std::max(1u, std::thread::hardware_concurrency());
+        return args.packed ? simulate<PackedSites>(args, lattice, str_z, args.run, args.seed, n_threads)
+                           : simulate<ByteSites>(args, lattice, str_z, args.run, args.seed, n_threads);
+    }
+
+    // replicas run, run+1, ..., run+replicas-1 share the lattice; replica r gets the Philox key
+    // replicaSeed(seed, r), recorded in its own outputs so it can be rerun on its own
+    uint64_t base_seed = args.seed;
+    if (base_seed == 0) {
+        std::random_device rd;
+        base_seed = (static_cast<uint64_t>(rd()) << 32) | static_cast<uint64_t>(rd());
+    }
+
+    int n_threads = args.threads > 0 ? args.threads : std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::min(n_threads, args.replicas);
+
+    std::atomic<int> next_replica{0};
+    std::atomic<int> failures{0};
+
+    auto worker = [&]() {
+        for (int r = next_replica++; r < args.replicas; r = next_replica++) {
+            try {
+                auto run = args.packed ? simulate<PackedSites> : simulate<ByteSites>;
+                if (run(args, lattice, str_z, args.run + r, replicaSeed(base_seed, r), 1) != 0) failures++;
+            } catch (const std::exception& e) {
+                std::cerr << "run " << args.run + r << ": " << e.what() << std::endl;
+                failures++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+#ifndef WR_CHECKPOINT_H
+#define WR_CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../lattice/lattice_io.h"
+#include "cluster_stats.h"
+#include "equilibration.h"
+#include "histogram.h"
+#include "moments.h"
+#include "timeseries.h"
+
+// Simulator state at a sweep boundary, so a preempted or timed-out job can pick up where it
+// stopped (main.cpp --resume) and produce exactly the output an uninterrupted run would have.
+// Everything else (lattice, sublattices, observable counts) is rebuilt from these on restart.
+//
+// Layout (native little-endian):
+//   CheckpointHeader                              128 bytes
+//   int32 nodes[n_sites]
+//   MomentAccumulator moments[n_moments]          raw object bytes
+//   HistogramBin histogram[n_histogram]           raw struct bytes, N = 0 .. n_histogram - 1
+//   per equilibration detector:
+//     uint64 batch_length, n_batches, fill; double partial_sum; double batch_means[n_batches]
+//   cluster statistics:
+//     uint64 n_counts, samples, wrapping; double largest_sum, largest_sq_sum; uint64 counts[n_counts]
+// `checksum` is FNV-1a (64 bit) over everything after the header. The file is written to a
+// temporary name, fsync'ed and renamed over the old checkpoint, so a job killed mid-write
+// always leaves the previous complete checkpoint behind.
+
+constexpr char CHECKPOINT_MAGIC[8] = {'W', 'R', 'C', 'H', 'K', 'P', 'T', 0};
+constexpr uint32_t CHECKPOINT_VERSION = 5;
+
+// CheckpointHeader::flags
+constexpr uint32_t CHECKPOINT_EQUILIBRATED = 1;     // burn-in is over, moments are being accumulated
+constexpr uint32_t CHECKPOINT_FINISHED = 2;         // the run reached its stopping rule
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    int32_t L;
+    int32_t M;
+    double z;
+    char lat[16];
+    int32_t run;
+    uint32_t n_moments;
+    uint64_t seed;
+    uint64_t rng_counter;       // RandomStream::position(), words drawn
+    uint64_t sweep;             // next sweep to run
+    uint64_t n_sites;
+    uint64_t series_records;    // records of the time series that belong to sweeps before `sweep`
+    uint64_t burn_in;           // sweeps discarded before accumulating (once equilibrated)
+    uint32_t flags;
+    uint32_t n_detectors;
+    uint64_t n_histogram;
+    uint64_t checksum;
+};
+static_assert(sizeof(CheckpointHeader) == 128, "checkpoint header must stay 128 bytes");
+static_assert(std::is_trivially_copyable<MomentAccumulator>::value, "accumulators are stored as raw bytes");
+
+struct CheckpointState {
+    TimeSeriesInfo info;        // state point and seed the run was started with
+    uint64_t rng_counter = 0;
+    uint64_t sweep = 1;
+    uint64_t series_records = 0;
+    uint64_t burn_in = 0;
+    bool equilibrated = false;
+    bool finished = false;
+    std::vector<int> nodes;
+    std::vector<MomentAccumulator> moments;
+    std::vector<HistogramBin> histogram;
+    std::vector<EquilibrationDetector> detectors;
+    ClusterStatistics clusters;     // empty unless the run samples cluster statistics
+};
+
+// detectors flattened into the on-disk record format
+inline std::vector<char> packDetectors(const std::vector<EquilibrationDetector>& detectors) {
+    std::vector<char> bytes;
+    auto put = [&bytes](const void* p, std::size_t n) {
+        bytes.insert(bytes.end(), static_cast<const char*>(p), static_cast<const char*>(p) + n);
+    };
+    for (const EquilibrationDetector& d : detectors) {
+        uint64_t batch_length = d.batchLength();
+        uint64_t n_batches = d.batchMeans().size();
+        uint64_t fill = d.fill();
+        double sum = d.partialSum();
+        put(&batch_length, 8);
+        put(&n_batches, 8);
+        put(&fill, 8);
+        put(&sum, 8);
+        put(d.batchMeans().data(), n_batches * sizeof(double));
+    }
+    return bytes;
+}
+
+// detectors and cluster statistics, the variable-length tail of the file
+inline std::vector<char> packTail(const CheckpointState& state) {
+    std::vector<char> bytes = packDetectors(state.detectors);
+    auto put = [&bytes](const void* p, std::size_t n) {
+        bytes.insert(bytes.end(), static_cast<const char*>(p), static_cast<const char*>(p) + n);
+    };
+    const ClusterStatistics& c = state.clusters;
+    uint64_t meta[3] = {c.counts().size(), c.samples(), c.wrapping()};
+    double sums[2] = {c.largestSum(), c.largestSqSum()};
+    put(meta, sizeof(meta));
+    put(sums, sizeof(sums));
+    put(c.counts().data(), c.counts().size() * sizeof(uint64_t));
+    return bytes;
+}
+
+inline uint64_t checkpointChecksum(const CheckpointState& state, const std::vector<char>& tail_bytes) {
+    uint64_t h = fnv1a64(state.nodes.data(), state.nodes.size() * sizeof(int));
+    h = fnv1a64(state.moments.data(), state.moments.size() * sizeof(MomentAccumulator), h);
+    h = fnv1a64(state.histogram.data(), state.histogram.size() * sizeof(HistogramBin), h);
+    return fnv1a64(tail_bytes.data(), tail_bytes.size(), h);
+}
+
+inline void writeCheckpoint(const std::string& path, const CheckpointState& state) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
+    }
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.header_bytes = sizeof(CheckpointHeader);
+    header.L = state.info.L;
+    header.M = state.info.M;
+    header.z = state.info.z;
+    std::strncpy(header.lat, state.info.lat.c_str(), sizeof(header.lat) - 1);
+    header.run = state.info.run;
+    header.n_moments = state.moments.size();
+    header.seed = state.info.seed;
+    header.rng_counter = state.rng_counter;
+    header.sweep = state.sweep;
+    header.n_sites = state.nodes.size();
+    header.series_records = state.series_records;
+    header.burn_in = state.burn_in;
+    header.flags = (state.equilibrated ? CHECKPOINT_EQUILIBRATED : 0) | (state.finished ? CHECKPOINT_FINISHED : 0);
+    header.n_detectors = state.detectors.size();
+    header.n_histogram = state.histogram.size();
+
+    const std::vector<char> tail_bytes = packTail(state);
+    header.checksum = checkpointChecksum(state, tail_bytes);
+
+    const std::string tmp = path + ".tmp." + std::to_string(getpid());
+    std::FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error("Could not open " + tmp + " for writing.");
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = ok && std::fwrite(state.nodes.data(), sizeof(int), state.nodes.size(), out) == state.nodes.size();
+    ok = ok && std::fwrite(state.moments.data(), sizeof(MomentAccumulator), state.moments.size(), out) == state.moments.size();
+    ok = ok && std::fwrite(state.histogram.data(), sizeof(HistogramBin), state.histogram.size(), out) == state.histogram.size();
+    ok = ok && std::fwrite(tail_bytes.data(), 1, tail_bytes.size(), out) == tail_bytes.size();
+    ok = ok && std::fflush(out) == 0 && fsync(fileno(out)) == 0;
+    ok = (std::fclose(out) == 0) && ok;
+
+    if (!ok) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Failed writing checkpoint " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Could not move checkpoint into place: " + path);
+    }
+}
+
+inline CheckpointState readCheckpoint(const std::string& path) {
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) {
+        throw std::runtime_error("Could not open checkpoint " + path);
+    }
+
+    CheckpointHeader header;
+    CheckpointState state;
+    bool ok = std::fread(&header, sizeof(header), 1, in) == 1
+              && std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0
+              && header.version == CHECKPOINT_VERSION
+              && header.header_bytes == sizeof(CheckpointHeader);
+
+    if (ok) {
+        state.nodes.resize(header.n_sites);
+        state.moments.resize(header.n_moments);
+        state.histogram.resize(header.n_histogram);
+        ok = std::fread(state.nodes.data(), sizeof(int), state.nodes.size(), in) == state.nodes.size()
+             && std::fread(state.moments.data(), sizeof(MomentAccumulator), state.moments.size(), in) == state.moments.size()
+             && std::fread(state.histogram.data(), sizeof(HistogramBin), state.histogram.size(), in) == state.histogram.size();
+    }
+    for (uint32_t i = 0; ok && i < header.n_detectors; i++) {
+        uint64_t meta[3];
+        double sum;
+        ok = std::fread(meta, 8, 3, in) == 3 && std::fread(&sum, 8, 1, in) == 1;
+        std::vector<double> means(ok ? meta[1] : 0);
+        ok = ok && std::fread(means.data(), sizeof(double), means.size(), in) == means.size();
+        if (ok) state.detectors.emplace_back(meta[0], std::move(means), meta[2], sum);
+    }
+    if (ok) {
+        uint64_t meta[3];
+        double sums[2];
+        ok = std::fread(meta, 8, 3, in) == 3 && std::fread(sums, 8, 2, in) == 2;
+        std::vector<uint64_t> counts(ok ? meta[0] : 0);
+        ok = ok && std::fread(counts.data(), sizeof(uint64_t), counts.size(), in) == counts.size();
+        if (ok) state.clusters = ClusterStatistics(std::move(counts), meta[1], meta[2], sums[0], sums[1]);
+    }
+    std::fclose(in);
+
+    if (!ok || checkpointChecksum(state, packTail(state)) != header.checksum) {
+        throw std::runtime_error("Corrupt or incompatible checkpoint: " + path);
+    }
+
+    header.lat[sizeof(header.lat) - 1] = '\0';
+    state.info.L = header.L;
+    state.info.M = header.M;
+    state.info.z = header.z;
+    state.info.lat = header.lat;
+    state.info.run = header.run;
+    state.info.seed = header.seed;
+    state.rng_counter = header.rng_counter;
+    state.sweep = header.sweep;
+    state.series_records = header.series_records;
+    state.burn_in = header.burn_in;
+    state.equilibrated = header.flags & CHECKPOINT_EQUILIBRATED;
+    state.finished = header.flags & CHECKPOINT_FINISHED;
+    return state;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef WR_CLUSTER_LABELS_H
+#define WR_CLUSTER_LABELS_H
+
+#include <vector>
+
+#include "../lattice/lattice_graph.h"
+
+// Labels every connected cluster of occupied sites in one pass (union-find over the CSR bonds).
+//
+// Neighboring particles always share a species, so each occupied cluster is single-species,
+// and a full decomposition is just connectivity of the occupied sites. Labels are numbered
+// 0 .. count() - 1 in order of each cluster's lowest site, so they do not depend on how
+// the union-find trees happened to grow; empty sites get -1.
+//
+// With the cell count L given, label() also finds the clusters that wrap around the periodic
+// L x L lattice (the percolating ones). Sites are numbered (i0 * L + i1) * n_basis + s, so each
+// bond has a cell displacement; every site stores its displacement from its union-find parent,
+// and a bond closing a loop whose displacements do not add up to zero has gone around the
+// torus. This needs L >= 3, where a bond cannot reach a cell L / 2 away.
+
+class ClusterLabels {
+public:
+    ClusterLabels() = default;
+
+    explicit ClusterLabels(int n_sites)
+        : parent_(n_sites), label_(n_sites), dx_(n_sites), dy_(n_sites), wraps_root_(n_sites) {}
+
+    // cells = L for wrapping detection, 0 to skip it
+    template <typename Sites>
+    void label(const Sites& nodes, const LatticeGraph& adj, int cells = 0) {
+        const int n = adj.size();
+        const bool torus = cells >= 3 && n % (cells * cells) == 0;
+        const int n_basis = torus ? n / (cells * cells) : 1;
+        for (int i = 0; i < n; i++) {
+            parent_[i] = i;
+            dx_[i] = 0;
+            dy_[i] = 0;
+            wraps_root_[i] = 0;
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (nodes[i] == 0) continue;
+            for (int j : adj.neighbors(i)) {
+                if (j >= i || nodes[j] == 0) continue;
+                if (torus) {
+                    const int ci = i / n_basis, cj = j / n_basis;
+                    unite(i, j, periodic(cj / cells - ci / cells, cells), periodic(cj % cells - ci % cells, cells));
+                }
+                else {
+                    unite(i, j, 0, 0);
+                }
+            }
+        }
+
+        sizes_.clear();
+        wraps_.clear();
+        for (int i = 0; i < n; i++) {
+            if (nodes[i] == 0) {
+                label_[i] = -1;
+                continue;
+            }
+            int ox, oy;
+            const int root = find(i, ox, oy);
+            if (root == i) {            // the root is the lowest site of its cluster
+                label_[i] = sizes_.size();
+                sizes_.push_back(0);
+                wraps_.push_back(wraps_root_[i]);
+            }
+            else {
+                label_[i] = label_[root];
+            }
+            sizes_[label_[i]]++;
+        }
+    }
+
+    int count() const { return sizes_.size(); }
+    int operator[](int site) const { return label_[site]; }
+    const std::vector<int>& labels() const { return label_; }
+    const std::vector<int>& sizes() const { return sizes_; }
+    bool wraps(int cluster) const { return wraps_[cluster]; }
+
+private:
+    // displacement in -L/2 .. L/2 for a periodic difference of cell coordinates
+    static int periodic(int d, int cells) {
+        if (2 * d > cells) d -= cells;
+        if (2 * d < -cells) d += cells;
+        return d;
+    }
+
+    // root of i and i's displacement from it; the path is compressed onto the root
+    int find(int i, int& ox, int& oy) {
+        int root = i;
+        ox = 0;
+        oy = 0;
+        while (parent_[root] != root) {
+            ox += dx_[root];
+            oy += dy_[root];
+            root = parent_[root];
+        }
+        int x = i, x_dx = ox, x_dy = oy;
+        while (x != root && parent_[x] != root) {
+            const int next = parent_[x];
+            const int next_dx = x_dx - dx_[x], next_dy = x_dy - dy_[x];
+            parent_[x] = root;
+            dx_[x] = x_dx;
+            dy_[x] = x_dy;
+            x = next;
+            x_dx = next_dx;
+            x_dy = next_dy;
+        }
+        return root;
+    }
+
+    // bond a - b, where b sits (step_x, step_y) cells from a; the smaller root wins, so every
+    // root is the lowest site of its tree
+    void unite(int a, int b, int step_x, int step_y) {
+        int ax, ay, bx, by;
+        const int ra = find(a, ax, ay);
+        const int rb = find(b, bx, by);
+        if (ra == rb) {
+            if (ax + step_x != bx || ay + step_y != by) wraps_root_[ra] = 1;
+            return;
+        }
+        // displacement of rb from ra: pos(b) = pos(a) + step and pos(b) = pos(rb) + (bx, by)
+        const int dx = ax + step_x - bx, dy = ay + step_y - by;
+        if (ra < rb) {
+            parent_[rb] = ra;
+            dx_[rb] = dx;
+            dy_[rb] = dy;
+            wraps_root_[ra] |= wraps_root_[rb];
+        }
+        else {
+            parent_[ra] = rb;
+            dx_[ra] = -dx;
+            dy_[ra] = -dy;
+            wraps_root_[rb] |= wraps_root_[ra];
+        }
+    }
+
+    std::vector<int> parent_;
+    std::vector<int> label_;
+    std::vector<int> dx_;               // cell displacement from the parent
+    std::vector<int> dy_;
+    std::vector<char> wraps_root_;      // per root: its tree wraps around the torus
+    std::vector<int> sizes_;
+    std::vector<char> wraps_;           // per label
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef WR_CLUSTER_SEARCH_H
+#define WR_CLUSTER_SEARCH_H
+
+#include <vector>
+
+#include "../lattice/lattice_graph.h"
+
+// Reusable workspace for same-species cluster searches.
+//
+// A cluster move used to allocate a visited array, a queue and a result vector sized to the
+// lattice on every call, i.e. O(N) work per move no matter how small the cluster. recolor()
+// floods the cluster in place instead: a site that has been recolored no longer matches the
+// old species, so it is its own visited mark and no per-site array is needed. Only the stack
+// is kept between calls, so a move costs O(cluster size + its boundary).
+
+class ClusterSearch {
+public:
+    ClusterSearch() = default;
+
+    explicit ClusterSearch(int n_sites) {
+        stack_.reserve(n_sites);
+    }
+
+    // recolors the cluster of nodes[start] to new_value (!= nodes[start]), returns its size
+    template <typename Sites>
+    int recolor(Sites& nodes, const LatticeGraph& adj, int start, int new_value) {
+        const int target_value = nodes[start];
+        int size = 1;
+
+        nodes[start] = new_value;
+        stack_.clear();
+        stack_.push_back(start);
+
+        while (!stack_.empty()) {
+            int u = stack_.back();
+            stack_.pop_back();
+
+            for (int v : adj.neighbors(u)) {
+                if (nodes[v] == target_value) {
+                    nodes[v] = new_value;
+                    stack_.push_back(v);
+                    size++;
+                }
+            }
+        }
+
+        return size;
+    }
+
+private:
+    std::vector<int> stack_;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef WR_CLUSTER_STATS_H
+#define WR_CLUSTER_STATS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "cluster_labels.h"
+#include "timeseries.h"
+
+// Occupied-cluster statistics of a run, for the demixing / percolation analysis.
+//
+// Every sample is one full decomposition (ClusterLabels, near-linear union-find) and adds:
+//   - every cluster to the size histogram, counts[s - 1] = clusters of size s summed over samples
+//   - the largest cluster's fraction of the sites, P = s_max / N, and P^2
+//   - whether some cluster wraps around the periodic lattice (percolation indicator)
+//
+// Layout of data/sampling/clusters/clusters_<...>.bin (native little-endian):
+//   ClusterStatsHeader                      112 bytes
+//   uint64 counts[max_size]                 cluster sizes 1 .. max_size, raw
+// The file is rewritten (temporary name + rename) at every checkpoint and at the end.
+
+constexpr char CLUSTER_STATS_MAGIC[8] = {'W', 'R', 'C', 'L', 'U', 'S', 'T', 0};
+constexpr uint32_t CLUSTER_STATS_VERSION = 1;
+
+struct ClusterStatsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    int32_t L;
+    int32_t M;
+    double z;
+    char lat[16];
+    int32_t run;
+    uint32_t stride;            // sweeps between samples
+    uint64_t seed;
+    uint64_t n_sites;
+    uint64_t samples;
+    uint64_t wrapping;          // samples with a cluster wrapping around the lattice
+    double largest_sum;         // sums of P and P^2 over the samples
+    double largest_sq_sum;
+    uint64_t max_size;
+};
+static_assert(sizeof(ClusterStatsHeader) == 112, "cluster statistics header must stay 112 bytes");
+
+class ClusterStatistics {
+public:
+    ClusterStatistics() = default;
+
+    explicit ClusterStatistics(std::size_t n_sites) : counts_(n_sites, 0) {}
+
+    // restores statistics saved by a checkpoint
+    ClusterStatistics(std::vector<uint64_t> counts, uint64_t samples, uint64_t wrapping, double largest_sum, double largest_sq_sum)
+        : counts_(std::move(counts)), samples_(samples), wrapping_(wrapping),
+          largest_sum_(largest_sum), largest_sq_sum_(largest_sq_sum) {}
+
+    template <typename Sites>
+    void measure(const Sites& nodes, const LatticeGraph& adj, ClusterLabels& clusters, int L) {
+        clusters.label(nodes, adj, L);
+
+        int largest = 0;
+        bool wrapping = false;
+        for (int c = 0; c < clusters.count(); c++) {
+            const int size = clusters.sizes()[c];
+            counts_[size - 1]++;
+            if (size > largest) largest = size;
+            if (clusters.wraps(c)) wrapping = true;
+        }
+
+        const double P = counts_.empty() ? 0.0 : static_cast<double>(largest) / counts_.size();
+        samples_++;
+        wrapping_ += wrapping;
+        largest_sum_ += P;
+        largest_sq_sum_ += P * P;
+    }
+
+    const std::vector<uint64_t>& counts() const { return counts_; }
+    uint64_t samples() const { return samples_; }
+    uint64_t wrapping() const { return wrapping_; }
+    double largestSum() const { return largest_sum_; }
+    double largestSqSum() const { return largest_sq_sum_; }
+
+private:
+    std::vector<uint64_t> counts_;      // index s - 1 for size s, s = 1 .. n_sites
+    uint64_t samples_ = 0;
+    uint64_t wrapping_ = 0;
+    double largest_sum_ = 0;
+    double largest_sq_sum_ = 0;
+};
+
+// only sizes up to the largest one seen are stored
+inline void writeClusterStats(const std::string& path, const TimeSeriesInfo& info, int stride, const ClusterStatistics& stats) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
+    }
+
+    const std::vector<uint64_t>& counts = stats.counts();
+    uint64_t max_size = counts.size();
+    while (max_size > 0 && counts[max_size - 1] == 0) max_size--;
+
+    ClusterStatsHeader header{};
+    std::memcpy(header.magic, CLUSTER_STATS_MAGIC, sizeof(header.magic));
+    header.version = CLUSTER_STATS_VERSION;
+    header.header_bytes = sizeof(ClusterStatsHeader);
+    header.L = info.L;
+    header.M = info.M;
+    header.z = info.z;
+    std::strncpy(header.lat, info.lat.c_str(), sizeof(header.lat) - 1);
+    header.run = info.run;
+    header.stride = stride;
+    header.seed = info.seed;
+    header.n_sites = counts.size();
+    header.samples = stats.samples();
+    header.wrapping = stats.wrapping();
+    header.largest_sum = stats.largestSum();
+    header.largest_sq_sum = stats.largestSqSum();
+    header.max_size = max_size;
+
+    const std::string tmp = path + ".tmp." + std::to_string(getpid());
+    std::FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error("Could not open " + tmp + " for writing.");
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+              && std::fwrite(counts.data(), sizeof(uint64_t), max_size, out) == max_size;
+    ok = (std::fclose(out) == 0) && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Failed writing cluster statistics " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Could not move cluster statistics into place: " + path);
+    }
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef WR_EQUILIBRATION_H
+#define WR_EQUILIBRATION_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Online equilibration detection with MSER (marginal standard error rule, White 1997) on
+// batch means of one observable.
+//
+// For a truncation point d over the n batch means y_0 .. y_{n-1},
+//     MSER(d) = sum_{j >= d} (y_j - mean(y_d .. y_{n-1}))^2 / (n - d)^2,
+// and the optimal warm-up is the d minimizing it. The series counts as equilibrated once that
+// minimum falls in the first half of the history; if it keeps landing late, the observable is
+// still drifting and the run needs more sweeps. Batching (100 sweeps by default) smooths the
+// per-sweep noise and keeps each check O(n / batch_length).
+
+class EquilibrationDetector {
+public:
+    explicit EquilibrationDetector(uint64_t batch_length = 100) : batch_length_(batch_length) {}
+
+    // restores a detector saved by a checkpoint
+    EquilibrationDetector(uint64_t batch_length, std::vector<double> batch_means, uint64_t fill, double sum)
+        : batch_length_(batch_length), means_(std::move(batch_means)), fill_(fill), sum_(sum) {}
+
+    // returns true when the sample completed a batch
+    bool add(double x) {
+        sum_ += x;
+        if (++fill_ < batch_length_) return false;
+        means_.push_back(sum_ / batch_length_);
+        fill_ = 0;
+        sum_ = 0;
+        return true;
+    }
+
+    // MSER-optimal number of batches to discard, searched over all but the last
+    // `min_tail` batches
+    std::size_t truncation() const {
+        const std::size_t n = means_.size();
+        const std::size_t min_tail = 5;
+        if (n <= min_tail) return n;
+
+        // suffix sums, walked backwards so each d costs O(1)
+        double s1 = 0, s2 = 0;
+        std::size_t best = n;
+        double best_value = 0;
+        for (std::size_t d = n; d-- > 0;) {
+            s1 += means_[d];
+            s2 += means_[d] * means_[d];
+            const double m = n - d;
+            if (m < min_tail) continue;
+            const double value = (s2 - s1 * s1 / m) / (m * m);
+            if (best == n || value <= best_value) {
+                best = d;
+                best_value = value;
+            }
+        }
+        return best;
+    }
+
+    // enough history and an MSER warm-up in its first half
+    bool equilibrated(std::size_t min_batches = 20) const {
+        return means_.size() >= min_batches && 2 * truncation() < means_.size();
+    }
+
+    uint64_t batchLength() const { return batch_length_; }
+    const std::vector<double>& batchMeans() const { return means_; }
+    uint64_t fill() const { return fill_; }     // samples in the current, incomplete batch
+    double partialSum() const { return sum_; }
+
+private:
+    uint64_t batch_length_;
+    std::vector<double> means_;
+    uint64_t fill_ = 0;
+    double sum_ = 0;
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef WR_HISTOGRAM_H
+#define WR_HISTOGRAM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "timeseries.h"
+
+// Per-particle-number histogram of a run, for reweighting in z (src/analysis/reweight.cpp).
+//
+// The grand-canonical weight depends on z only through z^N, so everything needed to move a
+// run to another fugacity is, for every N, the number of samples and the power sums of the
+// order parameters over those samples. That is the (N, m) joint distribution reduced to the
+// moments the Binder cumulant needs, and unlike a histogram over species counts it stays
+// small for any M.
+//
+// Layout (native little-endian):
+//   HistogramHeader                         96 bytes
+//   HistogramBin bins[n_max - n_min + 1]    N = n_min .. n_max, raw struct bytes
+
+constexpr char HISTOGRAM_MAGIC[8] = {'W', 'R', 'H', 'I', 'S', 'T', 0, 0};
+constexpr uint32_t HISTOGRAM_VERSION = 1;
+
+struct HistogramBin {
+    uint64_t count = 0;
+    double crystal[4] = {};     // sums of m, m^2, m^3, m^4
+    double demixed[4] = {};
+};
+static_assert(sizeof(HistogramBin) == 72, "histogram bins must stay 72 bytes");
+static_assert(std::is_trivially_copyable<HistogramBin>::value, "histogram bins are stored as raw bytes");
+
+struct HistogramHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    int32_t L;
+    int32_t M;
+    double z;
+    char lat[16];
+    int32_t run;
+    uint32_t bin_bytes;
+    uint64_t seed;
+    uint64_t n_sites;
+    uint64_t n_min;
+    uint64_t n_max;
+    uint64_t samples;
+};
+static_assert(sizeof(HistogramHeader) == 96, "histogram header must stay 96 bytes");
+
+class ParticleHistogram {
+public:
+    explicit ParticleHistogram(std::size_t n_sites = 0) : bins_(n_sites + 1) {}
+
+    void add(long long N, double cp, double dp) {
+        HistogramBin& b = bins_[N];
+        b.count++;
+        double c = cp, d = dp;
+        for (int p = 0; p < 4; p++) {
+            b.crystal[p] += c;
+            b.demixed[p] += d;
+            c *= cp;
+            d *= dp;
+        }
+    }
+
+    std::size_t sites() const { return bins_.size() - 1; }
+    std::vector<HistogramBin>& bins() { return bins_; }
+    const std::vector<HistogramBin>& bins() const { return bins_; }
+
+private:
+    std::vector<HistogramBin> bins_;    // indexed by N = 0 .. n_sites
+};
+
+// data/sampling/histogram/histogram_<...>.bin; only the occupied range of N is stored
+inline void writeHistogram(const std::string& path, const TimeSeriesInfo& info, const ParticleHistogram& histogram) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
+    }
+
+    const std::vector<HistogramBin>& bins = histogram.bins();
+    uint64_t n_min = 0, n_max = 0, samples = 0;
+    bool any = false;
+    for (std::size_t N = 0; N < bins.size(); N++) {
+        if (bins[N].count == 0) continue;
+        if (!any) n_min = N;
+        n_max = N;
+        samples += bins[N].count;
+        any = true;
+    }
+
+    HistogramHeader header{};
+    std::memcpy(header.magic, HISTOGRAM_MAGIC, sizeof(header.magic));
+    header.version = HISTOGRAM_VERSION;
+    header.header_bytes = sizeof(HistogramHeader);
+    header.L = info.L;
+    header.M = info.M;
+    header.z = info.z;
+    std::strncpy(header.lat, info.lat.c_str(), sizeof(header.lat) - 1);
+    header.run = info.run;
+    header.bin_bytes = sizeof(HistogramBin);
+    header.seed = info.seed;
+    header.n_sites = histogram.sites();
+    header.n_min = n_min;
+    header.n_max = n_max;
+    header.samples = samples;
+
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error("Could not open " + path + " for writing.");
+    }
+    const std::size_t n_bins = any ? n_max - n_min + 1 : 0;
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+              && std::fwrite(bins.data() + n_min, sizeof(HistogramBin), n_bins, out) == n_bins;
+    ok = (std::fclose(out) == 0) && ok;
+    if (!ok) {
+        throw std::runtime_error("Failed writing histogram " + path);
+    }
+}
+
+struct HistogramFile {
+    TimeSeriesInfo info;
+    uint64_t n_sites = 0;
+    uint64_t n_min = 0;                 // N of bins[0]
+    uint64_t samples = 0;
+    std::vector<HistogramBin> bins;
+};
+
+inline HistogramFile readHistogram(const std::string& path) {
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) {
+        throw std::runtime_error("Could not open histogram " + path);
+    }
+
+    HistogramHeader header;
+    HistogramFile file;
+    bool ok = std::fread(&header, sizeof(header), 1, in) == 1
+              && std::memcmp(header.magic, HISTOGRAM_MAGIC, sizeof(header.magic)) == 0
+              && header.version == HISTOGRAM_VERSION
+              && header.bin_bytes == sizeof(HistogramBin);
+    if (ok) {
+        std::fseek(in, header.header_bytes, SEEK_SET);
+        file.bins.resize(header.samples ? header.n_max - header.n_min + 1 : 0);
+        ok = std::fread(file.bins.data(), sizeof(HistogramBin), file.bins.size(), in) == file.bins.size();
+    }
+    std::fclose(in);
+    if (!ok) {
+        throw std::runtime_error("Corrupt or incompatible histogram: " + path);
+    }
+
+    header.lat[sizeof(header.lat) - 1] = '\0';
+    file.info.L = header.L;
+    file.info.M = header.M;
+    file.info.z = header.z;
+    file.info.lat = header.lat;
+    file.info.run = header.run;
+    file.info.seed = header.seed;
+    file.n_sites = header.n_sites;
+    file.n_min = header.n_min;
+    file.samples = header.samples;
+    return file;
+}
+
+#endif
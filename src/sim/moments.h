@@ -0,0 +1,150 @@
+#ifndef WR_MOMENTS_H
+#define WR_MOMENTS_H
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "timeseries.h"
+
+// Running moments of an observable after burn-in, so the analysis stage can get the Binder
+// cumulant U = 1 - <m^4> / (3 <m^2>^2) and its error from a few numbers per run instead of
+// re-reading the raw time series.
+//
+// Besides the power sums over all samples, the samples are cut into consecutive blocks of
+// `block_length`; the spread of the per-block means and per-block cumulants gives the error
+// bars (the same block estimate cumulant_computation.py makes with L_opt = 2000).
+
+struct PowerSums {
+    uint64_t n = 0;
+    double s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+
+    void add(double x) {
+        double x2 = x * x;
+        n++;
+        s1 += x;
+        s2 += x2;
+        s3 += x2 * x;
+        s4 += x2 * x2;
+    }
+
+    double mean() const { return s1 / n; }
+    double binder() const {
+        double m2 = s2 / n;
+        double m4 = s4 / n;
+        return 1 - (1.0/3)*(m4/(m2*m2));
+    }
+};
+
+// Welford mean/variance of a stream of per-block values
+struct BlockStats {
+    uint64_t n = 0;
+    double mean = 0, m2 = 0;
+
+    void add(double x) {
+        n++;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+
+    // standard error of the mean over blocks
+    double error() const {
+        if (n < 2) return std::numeric_limits<double>::quiet_NaN();
+        return std::sqrt(m2 / (n - 1) / n);
+    }
+};
+
+class MomentAccumulator {
+public:
+    explicit MomentAccumulator(uint64_t block_length = 2000) : block_length_(block_length) {}
+
+    void add(double x) {
+        total_.add(x);
+        block_.add(x);
+        if (block_.n == block_length_) {
+            block_means_.add(block_.mean());
+            block_binders_.add(block_.binder());
+            block_ = PowerSums{};
+        }
+    }
+
+    uint64_t samples() const { return total_.n; }
+    uint64_t blockLength() const { return block_length_; }
+    const PowerSums& sums() const { return total_; }
+    const BlockStats& blockMeans() const { return block_means_; }
+    const BlockStats& blockBinders() const { return block_binders_; }
+
+private:
+    uint64_t block_length_;
+    PowerSums total_;
+    PowerSums block_;           // current, incomplete block
+    BlockStats block_means_;
+    BlockStats block_binders_;
+};
+
+// Per-run summary (data/sampling/summary/summary_<...>.json), read by
+// src/actions/timeseries_io.py:load_summary.
+inline void writeSummaryJson(const std::string& path, const TimeSeriesInfo& info, uint64_t sweeps, uint64_t burn_in,
+                             const std::vector<std::pair<std::string, const MomentAccumulator*>>& observables) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Could not open " + path + " for writing.");
+    }
+
+    // JSON has no NaN; undefined estimates (e.g. fewer than two blocks) are written as null
+    auto num = [](double v) {
+        std::ostringstream ss;
+        if (std::isfinite(v)) ss << std::setprecision(17) << v;
+        else ss << "null";
+        return ss.str();
+    };
+
+    out << "{\n";
+    out << "  \"L\": " << info.L << ",\n";
+    out << "  \"M\": " << info.M << ",\n";
+    out << "  \"z\": " << num(info.z) << ",\n";
+    out << "  \"lat\": \"" << info.lat << "\",\n";
+    out << "  \"run\": " << info.run << ",\n";
+    out << "  \"seed\": " << info.seed << ",\n";
+    out << "  \"sweeps\": " << sweeps << ",\n";
+    out << "  \"burn_in\": " << burn_in << ",\n";
+    out << "  \"observables\": {";
+
+    for (std::size_t o = 0; o < observables.size(); o++) {
+        const MomentAccumulator& acc = *observables[o].second;
+        const PowerSums& s = acc.sums();
+        double n = s.n;
+
+        out << (o ? "," : "") << "\n    \"" << observables[o].first << "\": {\n";
+        out << "      \"samples\": " << s.n << ",\n";
+        out << "      \"mean\": " << num(s.s1 / n) << ",\n";
+        out << "      \"m2\": " << num(s.s2 / n) << ",\n";
+        out << "      \"m3\": " << num(s.s3 / n) << ",\n";
+        out << "      \"m4\": " << num(s.s4 / n) << ",\n";
+        out << "      \"binder\": " << num(s.binder()) << ",\n";
+        out << "      \"block_length\": " << acc.blockLength() << ",\n";
+        out << "      \"blocks\": " << acc.blockBinders().n << ",\n";
+        out << "      \"mean_error\": " << num(acc.blockMeans().error()) << ",\n";
+        out << "      \"binder_block_mean\": " << num(acc.blockBinders().n ? acc.blockBinders().mean : NAN) << ",\n";
+        out << "      \"binder_error\": " << num(acc.blockBinders().error()) << "\n";
+        out << "    }";
+    }
+
+    out << "\n  }\n}\n";
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef WR_NEIGHBOR_CHECK_H
+#define WR_NEIGHBOR_CHECK_H
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WR_HAVE_X86 1
+#endif
+
+#include "../lattice/lattice_graph.h"
+#include "site_storage.h"
+
+// Insertion conflict test: would species k at site i touch a particle of another species?
+//
+// The neighbors of a regular lattice (D = 3..6 of them, known at compile time) are tested
+// all at once instead of one compare-and-branch each:
+//   - AVX2, byte storage: one masked gather of the D neighbor bytes, two lane compares
+//     (empty, same species), one movemask. Chosen at run time with __builtin_cpu_supports,
+//     so the same binary runs on nodes without AVX2.
+//   - otherwise (no AVX2, packed storage): the D values are packed into a 64-bit word, one
+//     byte each, and the two tests run on all bytes together (SWAR), without branches.
+// D = 0 (irregular lattices) walks the CSR row with an early exit.
+
+#ifdef WR_HAVE_X86
+inline bool cpuHasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+// sites must stay readable 3 bytes past the last site (ByteSites pads for this): each lane
+// gathers the 32-bit word starting at its neighbor and keeps the low byte
+template <int D>
+__attribute__((target("avx2"))) bool conflictsAvx2(const uint8_t* sites, const int* neighbors, int k) {
+    static_assert(D > 0 && D <= 8, "AVX2 conflict test handles 1 to 8 neighbors");
+    if constexpr (D <= 4) {
+        const __m128i active = _mm_cmpgt_epi32(_mm_set1_epi32(D), _mm_setr_epi32(0, 1, 2, 3));
+        const __m128i index = _mm_maskload_epi32(neighbors, active);
+        __m128i v = _mm_mask_i32gather_epi32(_mm_setzero_si128(), reinterpret_cast<const int*>(sites), index, active, 1);
+        v = _mm_and_si128(v, _mm_set1_epi32(0xFF));
+        const __m128i ok = _mm_or_si128(_mm_cmpeq_epi32(v, _mm_setzero_si128()), _mm_cmpeq_epi32(v, _mm_set1_epi32(k)));
+        return _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(ok, active))) != 0;
+    }
+    else {
+        const __m256i active = _mm256_cmpgt_epi32(_mm256_set1_epi32(D), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m256i index = _mm256_maskload_epi32(neighbors, active);
+        __m256i v = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(sites), index, active, 1);
+        v = _mm256_and_si256(v, _mm256_set1_epi32(0xFF));
+        const __m256i ok = _mm256_or_si256(_mm256_cmpeq_epi32(v, _mm256_setzero_si256()), _mm256_cmpeq_epi32(v, _mm256_set1_epi32(k)));
+        return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(ok, active))) != 0;
+    }
+}
+#endif
+
+// bytes of w that are non-zero get their high bit set, all other bits cleared
+inline uint64_t nonzeroBytes(uint64_t w) {
+    constexpr uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    return (((w & low7) + low7) | w) & ~low7;
+}
+
+template <int D, typename Sites>
+inline bool conflictsSwar(const Sites& nodes, const int* neighbors, int k) {
+    static_assert(D > 0 && D <= 8, "SWAR conflict test handles 1 to 8 neighbors");
+    uint64_t w = 0;
+    for (int j = 0; j < D; j++) {
+        w |= static_cast<uint64_t>(nodes[neighbors[j]]) << (8 * j);
+    }
+    const uint64_t lanes = D == 8 ? ~0ULL : (1ULL << (8 * D)) - 1;
+    const uint64_t other = w ^ (static_cast<uint64_t>(k) * 0x0101010101010101ULL & lanes);
+    return (nonzeroBytes(w) & nonzeroBytes(other)) != 0;
+}
+
+template <int D, typename Sites>
+inline bool conflicts(const Sites& nodes, const LatticeGraph& lattice_adjacency_list, int i, int k) {
+    if constexpr (D > 0) {
+        const int* neighbors = lattice_adjacency_list.regularNeighbors<D>(i);
+#ifdef WR_HAVE_X86
+        if constexpr (std::is_same<Sites, ByteSites>::value) {
+            if (cpuHasAvx2()) {
+                return conflictsAvx2<D>(nodes.data(), neighbors, k);
+            }
+        }
+#endif
+        return conflictsSwar<D>(nodes, neighbors, k);
+    }
+    else {
+        for (int index : lattice_adjacency_list.neighbors(i)) {
+            if (k != nodes[index] && nodes[index] != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef WR_NFOLD_H
+#define WR_NFOLD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../lattice/lattice_graph.h"
+#include "observables.h"
+#include "random_stream.h"
+
+// Rejection-free (n-fold way, Bortz-Kalos-Lebowitz) version of the random-site sweep.
+//
+// In sweep() every site is attempted once per sweep on average, and most attempts in the
+// dense phase do nothing. Here the same moves run as a continuous-time process in which a
+// site makes each move at the rate sweep() would accept it, per sweep:
+//   empty, no occupied neighbor            insert (species uniform)    A_insert
+//   empty, occupied neighbors all species c insert c                    A_insert / M
+//   empty, neighbors of several species     -                           0
+//   occupied                                remove                      p * A_remove
+//                                           recolor cluster             1 - p
+// Sites are kept in one list per class, so an event is drawn directly from the total rate R
+// and the clock advances by an Exp(R) waiting time. Every drawn event is performed.
+//
+// The chain is sampled at the sweep boundaries of the continuous clock. Those snapshots have
+// the stationary distribution, and unlike per-sweep time averages they keep the Binder
+// cumulant (which needs instantaneous m^2, m^4) meaningful. The pending waiting time is
+// redrawn at every boundary (exact, by memorylessness), so between sweeps the state is just the
+// nodes, the rng and the order of the class lists; rebuild() makes that order canonical.
+
+template <typename Sites>
+class NFoldEngine {
+public:
+    enum SiteClass { EMPTY_FREE = 0, EMPTY_SINGLE = 1, EMPTY_BLOCKED = 2, OCCUPIED = 3 };
+
+    NFoldEngine(const LatticeGraph& adj, int M, double z, double p = 0.95)
+        : adj_(&adj), M_(M), p_(p),
+          A_remove_(std::min(1.0, (1.0/(z*M*p)))), A_insert_(std::min(1.0, (z*M*p))),
+          n_occ_(adj.size(), 0), s1_(adj.size(), 0), s2_(adj.size(), 0),
+          class_(adj.size(), EMPTY_FREE), pos_(adj.size(), 0) {
+        stack_.reserve(adj.size());
+        rate_[EMPTY_FREE] = A_insert_;
+        rate_[EMPTY_SINGLE] = A_insert_ / M;
+        rate_[EMPTY_BLOCKED] = 0;
+        rate_[OCCUPIED] = p * A_remove_ + (1 - p);
+    }
+
+    // neighbor statistics and site classes from scratch
+    void rebuild(const Sites& nodes) {
+        for (auto& list : members_) list.clear();
+        for (int i = 0; i < adj_->size(); i++) {
+            if (nodes[i] == 0) recount(nodes, i);
+            class_[i] = classify(nodes, i);
+            pos_[i] = members_[class_[i]].size();
+            members_[class_[i]].push_back(i);
+        }
+    }
+
+    // runs the process for one unit of time (one sweep)
+    void sweep(Sites& nodes, ObservableTracker& observables, RandomStream& rng) {
+        double t = 0;
+        while (true) {
+            const double R = totalRate();
+            if (R <= 0) return;
+            t += -std::log(1.0 - rng.uniform()) / R;
+            if (t >= 1.0) return;
+            event(nodes, observables, rng, rng.uniform() * R);
+        }
+    }
+
+    double totalRate() const {
+        double R = 0;
+        for (int c = 0; c < 4; c++) R += rate_[c] * members_[c].size();
+        return R;
+    }
+
+private:
+    int classify(const Sites& nodes, int i) const {
+        if (nodes[i] != 0) return OCCUPIED;
+        if (n_occ_[i] == 0) return EMPTY_FREE;
+        // all occupied neighbors share one species iff their species have zero variance
+        return n_occ_[i] * s2_[i] == s1_[i] * s1_[i] ? EMPTY_SINGLE : EMPTY_BLOCKED;
+    }
+
+    void move(int i, int c) {
+        if (class_[i] == c) return;
+        std::vector<int>& from = members_[class_[i]];
+        int last = from.back();
+        from[pos_[i]] = last;
+        pos_[last] = pos_[i];
+        from.pop_back();
+
+        class_[i] = c;
+        pos_[i] = members_[c].size();
+        members_[c].push_back(i);
+    }
+
+    // occupied-neighbor statistics of site i
+    void recount(const Sites& nodes, int i) {
+        n_occ_[i] = 0;
+        s1_[i] = 0;
+        s2_[i] = 0;
+        for (int j : adj_->neighbors(i)) {
+            if (nodes[j] != 0) {
+                n_occ_[i]++;
+                s1_[i] += nodes[j];
+                s2_[i] += static_cast<long long>(nodes[j]) * nodes[j];
+            }
+        }
+    }
+
+    // site i changed from species a to b (0 = empty): update its empty neighbors
+    void changed(const Sites& nodes, int i, int a, int b) {
+        for (int j : adj_->neighbors(i)) {
+            if (nodes[j] != 0) continue;
+            n_occ_[j] += (b != 0) - (a != 0);
+            s1_[j] += b - a;
+            s2_[j] += static_cast<long long>(b) * b - static_cast<long long>(a) * a;
+            move(j, classify(nodes, j));
+        }
+    }
+
+    // flood-fills the cluster of `start` with col, updating the empty sites around it in the
+    // same pass (each cluster-to-empty bond is seen once); returns the cluster size
+    int recolor(Sites& nodes, int start, int col) {
+        const int old_col = nodes[start];
+        const long long d1 = col - old_col;
+        const long long d2 = static_cast<long long>(col) * col - static_cast<long long>(old_col) * old_col;
+        int size = 1;
+
+        nodes[start] = col;
+        stack_.clear();
+        stack_.push_back(start);
+        while (!stack_.empty()) {
+            int u = stack_.back();
+            stack_.pop_back();
+            for (int v : adj_->neighbors(u)) {
+                if (nodes[v] == old_col) {
+                    nodes[v] = col;
+                    stack_.push_back(v);
+                    size++;
+                }
+                else if (nodes[v] == 0) {
+                    s1_[v] += d1;
+                    s2_[v] += d2;
+                    move(v, classify(nodes, v));
+                }
+            }
+        }
+        return size;
+    }
+
+    // the event at position x in [0, R) of the rate-weighted class lists (R > 0)
+    void event(Sites& nodes, ObservableTracker& observables, RandomStream& rng, double x) {
+        // rounding in R and in the subtractions can carry x past the last class with events
+        int last = 3;
+        while (last > 0 && rate_[last] * members_[last].size() == 0) last--;
+
+        int c = 0;
+        while (c < last && x >= rate_[c] * members_[c].size()) {
+            x -= rate_[c] * members_[c].size();
+            c++;
+        }
+        const std::vector<int>& list = members_[c];
+        const std::size_t index = std::min(list.size() - 1, static_cast<std::size_t>(x / rate_[c]));
+        const int i = list[index];
+        // uniform in [0, 1), reused for the move choice
+        const double within = std::min(x / rate_[c] - index, std::nextafter(1.0, 0.0));
+
+        if (c == EMPTY_FREE || c == EMPTY_SINGLE) {
+            int k;
+            if (c == EMPTY_FREE) {
+                k = rng.uniformInt(1, M_);
+            } else {
+                k = static_cast<int>(s1_[i] / n_occ_[i]);
+            }
+            nodes[i] = k;
+            observables.insert(i, k);
+            move(i, OCCUPIED);
+            changed(nodes, i, 0, k);
+        }
+        else if (within * rate_[OCCUPIED] < p_ * A_remove_) {
+            const int k = nodes[i];
+            nodes[i] = 0;
+            observables.remove(i, k);
+            recount(nodes, i);
+            move(i, classify(nodes, i));
+            changed(nodes, i, k, 0);
+        }
+        else if (M_ > 1) {
+            const int old_col = nodes[i];
+            const int col = (old_col - 1 + rng.uniformInt(1, M_ - 1)) % M_ + 1;
+
+            observables.recolor(old_col, col, recolor(nodes, i, col));
+        }
+    }
+
+    const LatticeGraph* adj_;
+    int M_;
+    double p_;
+    double A_remove_;
+    double A_insert_;
+    double rate_[4];
+
+    // kept for empty sites only; a site's are recounted when it is emptied
+    std::vector<int> n_occ_;            // occupied neighbors
+    std::vector<long long> s1_;         // sum of their species
+    std::vector<long long> s2_;         // sum of squared species
+    std::vector<int> class_;
+    std::vector<int> pos_;              // index in members_[class_]
+    std::vector<int> members_[4];
+    std::vector<int> stack_;
+};
+
+#endif
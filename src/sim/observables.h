@@ -0,0 +1,124 @@
+#ifndef WR_OBSERVABLES_H
+#define WR_OBSERVABLES_H
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+// Order parameters maintained incrementally during the sweep.
+//
+// The tracker keeps the number of particles of every species and the number of occupied
+// sites on every sublattice. Each move reports the sites it changed (O(1) per site), so the
+// per-sweep measurements cost O(M + k) instead of several O(k * N) passes over copies of
+// the lattice. The formulas are exactly those of crystalParameter, density and
+// demixedParameter in main.cpp, evaluated in the same floating-point order.
+
+class ObservableTracker {
+public:
+    ObservableTracker() = default;
+
+    // sublattice labels are 1..k; the tracker keeps a pointer, so they must outlive it
+    ObservableTracker(int M, int k, const std::vector<int>& sublattice)
+        : M_(M), k_(k), n_sites_(sublattice.size()), sublattice_(&sublattice),
+          species_count_(M + 1, 0), sub_occupied_(k + 1, 0), sub_total_(k + 1, 0) {
+        for (int label : sublattice) {
+            sub_total_[label]++;
+        }
+        for (int i = 1; i <= M; i++) {
+            double angle = 2 * M_PI * (i - 1)/M;
+            euler_.push_back(std::exp(std::complex<double>(0, -1 * angle)));
+        }
+    }
+
+    // full recount, e.g. after the random initial configuration
+    template <typename Sites>
+    void rebuild(const Sites& nodes) {
+        std::fill(species_count_.begin(), species_count_.end(), 0);
+        std::fill(sub_occupied_.begin(), sub_occupied_.end(), 0);
+        occupied_ = 0;
+        for (long long i = 0; i < n_sites_; i++) {
+            int s = nodes[i];
+            if (s != 0) {
+                insert(i, s);
+            }
+        }
+    }
+
+    void insert(int site, int species) {
+        species_count_[species]++;
+        sub_occupied_[(*sublattice_)[site]]++;
+        occupied_++;
+    }
+
+    void remove(int site, int species) {
+        species_count_[species]--;
+        sub_occupied_[(*sublattice_)[site]]--;
+        occupied_--;
+    }
+
+    // `count` particles of one species added (or removed, count < 0) on one sublattice, e.g.
+    // the merged result of a parallel pass over that sublattice
+    void add(int species, int label, long long count) {
+        species_count_[species] += count;
+        sub_occupied_[label] += count;
+        occupied_ += count;
+    }
+
+    // a cluster of `size` sites changed species; sublattice occupancy is unaffected
+    void recolor(int old_species, int new_species, int size) {
+        species_count_[old_species] -= size;
+        species_count_[new_species] += size;
+    }
+
+    double density() const {
+        return double(occupied_) / n_sites_;
+    }
+
+    double crystal() const {
+        double sum = 0.0;
+        for (int i = 1; i <= k_; i++) {
+            sum += rho(i);
+        }
+        double mean = sum / k_;
+
+        double sqSum = 0.0;
+        for (int i = 1; i <= k_; i++) {
+            double diff = rho(i) - mean;
+            sqSum += diff * diff;
+        }
+
+        return (k_ / std::sqrt(k_-1)) * std::sqrt(sqSum / (k_));
+    }
+
+    double demixed() const {
+        std::complex<double> total = std::complex<double>(0, 0);
+        const double rho_N = density() * n_sites_;
+        for (int i = 1; i <= M_; i++) {
+            double m_i = static_cast<double>(species_count_[i]) / rho_N;
+            total += (m_i * euler_[i - 1]);
+        }
+        return std::abs(total);
+    }
+
+    long long occupied() const { return occupied_; }
+    long long speciesCount(int species) const { return species_count_[species]; }
+    const std::vector<long long>& speciesCounts() const { return species_count_; }
+
+private:
+    double rho(int label) const {
+        return double(sub_occupied_[label]) / sub_total_[label];
+    }
+
+    int M_ = 0;
+    int k_ = 0;
+    long long n_sites_ = 0;
+    const std::vector<int>* sublattice_ = nullptr;
+
+    std::vector<long long> species_count_;     // index 0 unused
+    std::vector<long long> sub_occupied_;      // index 0 unused
+    std::vector<long long> sub_total_;
+    long long occupied_ = 0;
+    std::vector<std::complex<double>> euler_;  // exp(-2πi (i-1)/M)
+};
+
+#endif
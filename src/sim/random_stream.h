@@ -0,0 +1,120 @@
+#ifndef WR_RANDOM_STREAM_H
+#define WR_RANDOM_STREAM_H
+
+#include <openrand/philox.h>
+
+#include <cmath>
+#include <cstdint>
+
+// Buffered Philox stream for the sweep kernels.
+//
+// openrand::Philox runs all ten rounds for every draw() and returns one of the four 32-bit
+// words it produced. This keeps the whole block: one Philox call per four words. On top of
+// it, bounded integers use Lemire's multiply-shift (unbiased; the rejection branch almost
+// never runs) and Bernoulli trials compare a word against a precomputed integer threshold,
+// so no std::*_distribution objects or floating point are involved in a move.
+//
+// The block counter is 64 bits wide, split over Philox's internal counter (low half) and its
+// ctr1 word (high half), so long runs never wrap onto the start of their stream. position()
+// counts 32-bit words drawn and seek() jumps to any word; that number is all a checkpoint
+// needs to store. Independent streams differ in key (seed) or in `stream` / `substream`,
+// which fill the other two Philox counter words; each replica or thread owns its own.
+
+class RandomStream {
+public:
+    using result_type = uint32_t;
+
+    explicit RandomStream(uint64_t seed, uint32_t stream = 0, uint32_t substream = openrand::DEFAULT_GLOBAL_SEED)
+        : seed_(seed), stream_(stream), substream_(substream) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    result_type operator()() {
+        if (used_ == 4) refill();
+        return buffer_[used_++];
+    }
+
+    // uniform on 0 .. n - 1 (n > 0)
+    uint32_t below(uint32_t n) {
+        uint64_t m = static_cast<uint64_t>((*this)()) * n;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < n) {
+            const uint32_t reject = (0u - n) % n;   // 2^32 mod n
+            while (low < reject) {
+                m = static_cast<uint64_t>((*this)()) * n;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    // uniform on x .. y
+    int uniformInt(int x, int y) {
+        return x + static_cast<int>(below(static_cast<uint32_t>(y - x) + 1));
+    }
+
+    // uniform double in [0, 1) with 53 random bits
+    double uniform() {
+        const uint64_t hi = (*this)() >> 5;
+        const uint64_t lo = (*this)() >> 6;
+        return (hi * 67108864.0 + lo) * (1.0 / 9007199254740992.0);
+    }
+
+    uint64_t position() const { return block_ * 4 - (4 - used_); }
+
+    void seek(uint64_t position) {
+        block_ = position / 4;
+        used_ = 4;
+        if (position % 4 != 0) {
+            refill();
+            used_ = position % 4;
+        }
+    }
+
+private:
+    void refill() {
+        openrand::Philox philox(seed_, stream_, substream_, static_cast<uint32_t>(block_ >> 32));
+        philox._ctr = static_cast<uint32_t>(block_);
+        const openrand::uint4 out = philox.draw_int4();
+        buffer_[0] = out.x;
+        buffer_[1] = out.y;
+        buffer_[2] = out.z;
+        buffer_[3] = out.w;
+        block_++;
+        used_ = 0;
+    }
+
+    uint64_t seed_;
+    uint32_t stream_;
+    uint32_t substream_;
+    uint64_t block_ = 0;        // next block to generate
+    uint32_t buffer_[4] = {};
+    unsigned used_ = 4;         // words of buffer_ already handed out
+};
+
+// Bernoulli(p) as one integer comparison: true iff a 32-bit word is below ceil(p * 2^32).
+// p >= 1 and p <= 0 decide without drawing.
+class Threshold {
+public:
+    explicit Threshold(double p = 0) {
+        if (p >= 1) {
+            always_ = true;
+        }
+        else if (p > 0) {
+            limit_ = static_cast<uint64_t>(std::ceil(p * 4294967296.0));
+        }
+    }
+
+    bool operator()(RandomStream& rng) const {
+        if (always_) return true;
+        if (limit_ == 0) return false;
+        return rng() < limit_;
+    }
+
+private:
+    bool always_ = false;
+    uint64_t limit_ = 0;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef WR_SITE_STORAGE_H
+#define WR_SITE_STORAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Storage for the lattice state (0 = empty, 1..M = species).
+//
+// Kernels are templated on the container and only use size(), nodes[i] reads and
+// nodes[i] = k writes, so either of these can be plugged in:
+//   ByteSites     one byte per site (M <= 255), the default; three zero bytes of padding
+//                 after the last site let SIMD code load 32 bits at any site
+//   PackedSites   two sites per byte (M <= 15); writes are read-modify-write of a shared
+//                 byte, so two threads must never write neighboring indices concurrently
+// A quarter or an eighth of the int layout means far fewer cache lines per sweep; a
+// 1024 x 1024 lattice is 1 MB (bytes) or 512 KB (nibbles).
+
+class ByteSites {
+public:
+    ByteSites() = default;
+
+    explicit ByteSites(std::size_t n, int value = 0) : bytes_(n + 3, 0), n_(n) {
+        std::fill_n(bytes_.begin(), n, static_cast<uint8_t>(value));
+    }
+
+    std::size_t size() const { return n_; }
+
+    uint8_t operator[](std::size_t i) const { return bytes_[i]; }
+    uint8_t& operator[](std::size_t i) { return bytes_[i]; }
+
+    const uint8_t* data() const { return bytes_.data(); }
+
+private:
+    std::vector<uint8_t> bytes_;
+    std::size_t n_ = 0;
+};
+
+class PackedSites {
+public:
+    class Reference {
+    public:
+        Reference(uint8_t& byte, unsigned shift) : byte_(byte), shift_(shift) {}
+
+        operator int() const { return (byte_ >> shift_) & 0xF; }
+
+        Reference& operator=(int value) {
+            byte_ = static_cast<uint8_t>((byte_ & ~(0xF << shift_)) | (value << shift_));
+            return *this;
+        }
+        Reference& operator=(const Reference& other) { return *this = static_cast<int>(other); }
+
+    private:
+        uint8_t& byte_;
+        unsigned shift_;
+    };
+
+    PackedSites() = default;
+
+    explicit PackedSites(std::size_t n, int value = 0)
+        : bytes_((n + 1) / 2, static_cast<uint8_t>(value * 0x11)), n_(n) {}
+
+    std::size_t size() const { return n_; }
+
+    int operator[](std::size_t i) const { return (bytes_[i >> 1] >> ((i & 1) << 2)) & 0xF; }
+    Reference operator[](std::size_t i) { return Reference(bytes_[i >> 1], (i & 1) << 2); }
+
+private:
+    std::vector<uint8_t> bytes_;
+    std::size_t n_ = 0;
+};
+
+// checkpoints and images keep the int layout
+template <typename Sites>
+std::vector<int> unpackSites(const Sites& nodes) {
+    std::vector<int> values(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); i++) values[i] = nodes[i];
+    return values;
+}
+
+template <typename Sites>
+void loadSites(Sites& nodes, const std::vector<int>& values) {
+    for (std::size_t i = 0; i < values.size(); i++) nodes[i] = values[i];
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef WR_SWEEP_KERNELS_H
+#define WR_SWEEP_KERNELS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "../lattice/lattice_graph.h"
+#include "cluster_labels.h"
+#include "cluster_search.h"
+#include "neighbor_check.h"
+#include "observables.h"
+#include "random_stream.h"
+
+// Monte Carlo kernels shared by main and the benchmark (src/bench.cpp): initial fill, the
+// random-site sweep, the checkerboard sweep and the full cluster recoloring. The n-fold way
+// kernel lives in nfold.h.
+
+inline int randInt(RandomStream& rng, int x, int y) {
+    return rng.uniformInt(x, y);   // y ∼ Uniform{a,…,b}
+}
+
+// uniform on x..y without val (x <= val <= y, x < y): one draw over the y - x other values
+inline int randIntWithoutVal(RandomStream& rng, int x, int y, int val) {
+    int a = rng.uniformInt(x, y - 1);
+    if (a >= val) {
+        a++;
+    }
+    return a;
+}
+
+// acceptance probabilities of the local moves at fugacity z
+struct MoveRates {
+    Threshold p_remove;     // removal attempt, otherwise cluster recolor
+    Threshold A_remove;
+    Threshold A_insert;
+
+    MoveRates(double z, int M, double p = 0.95)
+        : p_remove(p), A_remove(std::min(1.0, (1.0/(z*M*p)))), A_insert(std::min(1.0, (z*M*p))) {}
+};
+
+// random initial configuration: every site is occupied with probability Mz/(Mz+1) by a random
+// species, unless that conflicts with an already occupied neighbor
+template <typename Sites>
+void randomFill(Sites& nodes, const LatticeGraph& lattice_adjacency_list, RandomStream& rng, int M, double z) {
+    Threshold bernoulli_trial((M*z)/((M*z)+1));
+
+    for (int i = 0; i < nodes.size(); i++) {
+        bool success = bernoulli_trial(rng);
+        if (success == false) { // if bernoulli probability outcomes false, make lattice(i,j) empty (0)
+            continue; // move to next iteration
+        }
+        else {
+            int k = randInt(rng, 1, M); // generate species (k = 1, 2, 3, ... , M)
+            bool conflict = false;
+            for (int index : lattice_adjacency_list.neighbors(i)) {
+                if (k != nodes[index] && nodes[index] != 0) {
+                    conflict = true;
+                    break;
+                }
+            }
+            if (conflict == false) {
+                nodes[i] = k;
+            }
+            else {
+                nodes[i] = 0;
+            }
+        }
+    }
+}
+
+// outcome of one attempted move of sweep(), reported to its probe
+enum MoveOutcome {
+    INSERTED, INSERT_REJECTED, INSERT_CONFLICT,     // empty site
+    REMOVED, REMOVE_REJECTED,                       // occupied site, removal attempt
+    RECOLORED,                                      // occupied site, cluster move
+    N_MOVE_OUTCOMES
+};
+
+// A probe sees every move of sweep(): begin() before the site is drawn, end() with the
+// outcome (and the cluster size of a recolor) once it is decided. This one compiles away;
+// the benchmark's probe times moves, a statistics build counts them.
+struct NoProbe {
+    void begin() {}
+    void end(MoveOutcome, int = 0) {}
+};
+
+// one sweep: N attempted moves at random sites
+template <int D, typename Sites, typename Probe>
+void sweep(Sites& nodes, const LatticeGraph& lattice_adjacency_list, ObservableTracker& observables,
+           ClusterSearch& cluster_search, MoveRates& rates, RandomStream& rng, int M, Probe& probe) {
+    for (int m = 0; m < nodes.size(); m++) {
+        probe.begin();
+        int i = randInt(rng, 0, nodes.size()-1); // Choose a site at random
+        int k = randInt(rng, 1, M);              // Choose a color at random
+
+        if (nodes[i] != 0) {
+            if (rates.p_remove(rng)) {
+                if (rates.A_remove(rng)) {
+                    observables.remove(i, nodes[i]);
+                    nodes[i] = 0;
+                    probe.end(REMOVED);
+                }
+                else {
+                    probe.end(REMOVE_REJECTED);
+                    continue;
+                }
+            }
+            else if (M > 1) {   // with one species there is no other color to recolor to
+                int old_col = nodes[i];
+                int col = randIntWithoutVal(rng, 1, M, old_col);
+                int size = cluster_search.recolor(nodes, lattice_adjacency_list, i, col);
+                observables.recolor(old_col, col, size);
+                probe.end(RECOLORED, size);
+            }
+        }
+        else {
+            if (rates.A_insert(rng)) {
+                if (!conflicts<D>(nodes, lattice_adjacency_list, i, k)) {
+                    nodes[i] = k;
+                    observables.insert(i, k);
+                    probe.end(INSERTED);
+                }
+                else {
+                    probe.end(INSERT_CONFLICT);
+                    continue;
+                }
+            }
+            else {
+                probe.end(INSERT_REJECTED);
+                continue;
+            }
+        }
+
+    }
+}
+
+template <int D, typename Sites>
+void sweep(Sites& nodes, const LatticeGraph& lattice_adjacency_list, ObservableTracker& observables,
+           ClusterSearch& cluster_search, MoveRates& rates, RandomStream& rng, int M) {
+    NoProbe probe;
+    sweep<D>(nodes, lattice_adjacency_list, observables, cluster_search, rates, rng, M, probe);
+}
+
+// calls f(std::integral_constant<int, D>{}) with D the lattice's coordination number, so the
+// kernels it runs are instantiated for it. The Archimedean lattices have degree 3 to 6;
+// anything else (irregular lattices included) gets D = 0, the generic CSR loop.
+template <typename F>
+void withDegree(const LatticeGraph& lattice_adjacency_list, F&& f) {
+    switch (lattice_adjacency_list.degree()) {
+        case 3: f(std::integral_constant<int, 3>{}); break;
+        case 4: f(std::integral_constant<int, 4>{}); break;
+        case 5: f(std::integral_constant<int, 5>{}); break;
+        case 6: f(std::integral_constant<int, 6>{}); break;
+        default: f(std::integral_constant<int, 0>{}); break;
+    }
+}
+
+// Swendsen-Wang style species update: every cluster gets an independent uniform species.
+// Clusters are single-species and never touch, and the weight z^N ignores species, so this
+// samples the species given the occupied sites exactly and complements any sweep kernel.
+template <typename Sites>
+void recolorClusters(Sites& nodes, const LatticeGraph& lattice_adjacency_list, ClusterLabels& clusters,
+                     ObservableTracker& observables, RandomStream& rng, int M) {
+    clusters.label(nodes, lattice_adjacency_list);
+
+    std::vector<int> species(clusters.count());
+    for (int& k : species) {
+        k = randInt(rng, 1, M);
+    }
+    for (int i = 0; i < nodes.size(); i++) {
+        if (clusters[i] >= 0) {
+            nodes[i] = species[clusters[i]];
+        }
+    }
+    observables.rebuild(nodes);
+}
+
+// Philox stream of the checkerboard kernel's per-site generators (the global_seed word)
+constexpr uint32_t CHECKERBOARD_STREAM = 0xC4EC4B0Du;
+
+// Sublattice-ordered sweep. Sites of one sublattice share no bonds, so their insert/remove
+// moves only read sites of the other sublattices and run in parallel. Every site draws from
+// its own Philox stream keyed by (seed, site), starting at an offset set by the sweep, so the
+// result does not depend on the number of threads.
+//
+// With probability 1 - p a site is a cluster candidate instead (decided before looking at the
+// site); candidates recolor their clusters serially after the parallel pass, in site order.
+// The other sites make a Metropolis insert/remove with min(1, zM) / min(1, 1/(zM)), so each
+// step given the candidate draws is in detailed balance on its own: the same ensemble as
+// sweep(), with different per-step rates.
+template <int D, typename Sites>
+void sweepCheckerboard(Sites& nodes, const LatticeGraph& lattice_adjacency_list,
+                       const std::vector<std::vector<int>>& sublattice_sites, ObservableTracker& observables,
+                       ClusterSearch& cluster_search, std::vector<int>& recolor_shift,
+                       uint64_t seed, int sweep_index, int M, double z, int n_threads, double p = 0.95) {
+    const double A_remove = std::min(1.0, 1.0/(z*M));
+    const double A_insert = std::min(1.0, z*M);
+
+    for (std::size_t c = 1; c < sublattice_sites.size(); c++) {
+        const std::vector<int>& sites = sublattice_sites[c];
+        std::vector<long long> delta(M + 1, 0);    // particles gained per species in this pass
+
+        #pragma omp parallel num_threads(n_threads)
+        {
+            std::vector<long long> local(M + 1, 0);
+            const Threshold cluster_move(1 - p);
+            const Threshold remove(A_remove);
+            const Threshold insert(A_insert);
+
+            #pragma omp for schedule(static)
+            for (std::size_t j = 0; j < sites.size(); j++) {
+                const int i = sites[j];
+                RandomStream rng(seed, i, CHECKERBOARD_STREAM);
+                rng.seek(static_cast<uint64_t>(sweep_index) << 34);   // block sweep_index * 2^32
+
+                if (cluster_move(rng)) {
+                    recolor_shift[i] = M > 1 ? randInt(rng, 1, M - 1) : 0; // new species = old + shift (mod M)
+                }
+                else if (nodes[i] != 0) {
+                    if (remove(rng)) {
+                        local[nodes[i]]--;
+                        nodes[i] = 0;
+                    }
+                }
+                else {
+                    int k = randInt(rng, 1, M);
+                    if (insert(rng)) {
+                        if (!conflicts<D>(nodes, lattice_adjacency_list, i, k)) {
+                            nodes[i] = k;
+                            local[k]++;
+                        }
+                    }
+                }
+            }
+
+            #pragma omp critical
+            for (int k = 1; k <= M; k++) {
+                delta[k] += local[k];
+            }
+        }
+
+        for (int k = 1; k <= M; k++) {
+            observables.add(k, c, delta[k]);
+        }
+
+        for (int i : sites) {
+            if (recolor_shift[i] == 0) continue;
+            const int shift = recolor_shift[i];
+            recolor_shift[i] = 0;
+            if (nodes[i] == 0) continue;
+
+            int old_col = nodes[i];
+            int col = (old_col - 1 + shift) % M + 1;
+            int size = cluster_search.recolor(nodes, lattice_adjacency_list, i, col);
+            observables.recolor(old_col, col, size);
+        }
+    }
+}
+
+#endif
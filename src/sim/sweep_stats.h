@@ -0,0 +1,177 @@
+#ifndef WR_SWEEP_STATS_H
+#define WR_SWEEP_STATS_H
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "sweep_kernels.h"
+#include "timeseries.h"
+
+// Hot-path statistics of a run, compiled in with -DWR_STATS:
+//   - the outcome of every move of the random kernel: insert accepted, rejected by A_insert or
+//     blocked by a neighbor of another species; remove accepted or rejected by A_remove;
+//     cluster recolor
+//   - sizes of the recolored clusters (power-of-two bins) and their mean
+//   - full cluster sweeps (--cluster-sweep-every) and the clusters they recolored
+//   - cycles spent in each phase of the sweep loop: kernel, full cluster sweeps, measurement, I/O
+// Only the random kernel reports its moves; for checkerboard and bkl runs "moves" and
+// "cluster_size" are written as null, the cluster sweeps and phase timers are counted for all.
+// Without WR_STATS the class is empty and every call compiles away, so the sweep loop reports
+// to it unconditionally. The numbers describe this process only and are not checkpointed.
+
+enum Phase { PHASE_SWEEP, PHASE_CLUSTER_SWEEP, PHASE_MEASURE, PHASE_IO, N_PHASES };
+
+// cycle counter; steady_clock ticks where there is no rdtsc
+inline uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+#ifdef WR_STATS
+
+class SweepStats {
+public:
+    static constexpr bool enabled = true;
+
+    explicit SweepStats(const std::string& kernel)
+        : last_(ticks()), start_ticks_(last_), start_time_(std::chrono::steady_clock::now()), kernel_(kernel) {}
+
+    // sweep() probe
+    void begin() {}
+    void end(MoveOutcome outcome, int size = 0) {
+        count_[outcome]++;
+        if (outcome == RECOLORED) {
+            cluster_bins_[31 - __builtin_clz(size)]++;
+            cluster_sites_ += size;
+        }
+    }
+
+    // one full cluster sweep that recolored `n_clusters` clusters
+    void clusterSweep(int n_clusters) {
+        cluster_sweeps_++;
+        cluster_sweep_clusters_ += n_clusters;
+    }
+
+    // charges the cycles since the previous lap to `phase`
+    void lap(Phase phase) {
+        const uint64_t now = ticks();
+        cycles_[phase] += now - last_;
+        last_ = now;
+    }
+
+    // JSON snapshot after `sweeps` sweeps of this process
+    void write(const std::string& path, const TimeSeriesInfo& info, uint64_t sweeps) const {
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent);
+        }
+
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Could not open " + path + " for writing.");
+        }
+
+        auto num = [](double v) {
+            std::ostringstream ss;
+            if (std::isfinite(v)) ss << std::setprecision(6) << v;
+            else ss << "null";
+            return ss.str();
+        };
+        auto ratio = [](uint64_t a, uint64_t b) { return b > 0 ? static_cast<double>(a) / b : NAN; };
+
+        const uint64_t inserts = count_[INSERTED] + count_[INSERT_REJECTED] + count_[INSERT_CONFLICT];
+        const uint64_t removes = count_[REMOVED] + count_[REMOVE_REJECTED];
+        const double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time_).count();
+        const double ns_per_cycle = elapsed_ns / (ticks() - start_ticks_);
+
+        int last_bin = cluster_bins_.size();
+        while (last_bin > 0 && cluster_bins_[last_bin - 1] == 0) last_bin--;
+
+        out << "{\n";
+        out << "  \"L\": " << info.L << ",\n";
+        out << "  \"M\": " << info.M << ",\n";
+        out << "  \"z\": " << num(info.z) << ",\n";
+        out << "  \"lat\": \"" << info.lat << "\",\n";
+        out << "  \"run\": " << info.run << ",\n";
+        out << "  \"seed\": " << info.seed << ",\n";
+        out << "  \"sweeps\": " << sweeps << ",\n";
+        out << "  \"kernel\": \"" << kernel_ << "\",\n";
+        if (kernel_ != "random") {             // the other kernels do not report their moves
+            out << "  \"moves\": null,\n";
+            out << "  \"cluster_size\": null,\n";
+        }
+        else {
+            out << "  \"moves\": {\n";
+            out << "    \"insert\": {\"accepted\": " << count_[INSERTED] << ", \"rejected\": " << count_[INSERT_REJECTED]
+                << ", \"conflict\": " << count_[INSERT_CONFLICT] << ", \"acceptance\": " << num(ratio(count_[INSERTED], inserts)) << "},\n";
+            out << "    \"remove\": {\"accepted\": " << count_[REMOVED] << ", \"rejected\": " << count_[REMOVE_REJECTED]
+                << ", \"acceptance\": " << num(ratio(count_[REMOVED], removes)) << "},\n";
+            out << "    \"recolor\": " << count_[RECOLORED] << "\n";
+            out << "  },\n";
+            out << "  \"cluster_size\": {\n";
+            out << "    \"mean\": " << num(ratio(cluster_sites_, count_[RECOLORED])) << ",\n";
+            out << "    \"log2_bins\": [";      // bin b: sizes 2^b .. 2^(b+1) - 1
+            for (int b = 0; b < last_bin; b++) {
+                out << (b ? ", " : "") << cluster_bins_[b];
+            }
+            out << "]\n";
+            out << "  },\n";
+        }
+        out << "  \"cluster_sweeps\": {\"sweeps\": " << cluster_sweeps_ << ", \"clusters\": " << cluster_sweep_clusters_
+            << ", \"mean_clusters\": " << num(ratio(cluster_sweep_clusters_, cluster_sweeps_)) << "},\n";
+        out << "  \"ns_per_cycle\": " << num(ns_per_cycle) << ",\n";
+        out << "  \"phases\": {";
+        const char* names[N_PHASES] = {"sweep", "cluster_sweep", "measure", "io"};
+        for (int p = 0; p < N_PHASES; p++) {
+            out << (p ? "," : "") << "\n    \"" << names[p] << "\": {\"cycles\": " << cycles_[p]
+                << ", \"seconds\": " << num(cycles_[p] * ns_per_cycle * 1e-9) << "}";
+        }
+        out << "\n  }\n}\n";
+    }
+
+private:
+    std::array<uint64_t, N_MOVE_OUTCOMES> count_{};
+    std::array<uint64_t, 32> cluster_bins_{};
+    uint64_t cluster_sites_ = 0;
+    uint64_t cluster_sweeps_ = 0;
+    uint64_t cluster_sweep_clusters_ = 0;
+    std::array<uint64_t, N_PHASES> cycles_{};
+    uint64_t last_;
+    uint64_t start_ticks_;
+    std::chrono::steady_clock::time_point start_time_;
+    std::string kernel_;
+};
+
+#else
+
+class SweepStats {
+public:
+    static constexpr bool enabled = false;
+
+    explicit SweepStats(const std::string&) {}
+
+    void begin() {}
+    void end(MoveOutcome, int = 0) {}
+    void clusterSweep(int) {}
+    void lap(Phase) {}
+    void write(const std::string&, const TimeSeriesInfo&, uint64_t) const {}
+};
+
+#endif
+
+#endif
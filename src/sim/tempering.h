@@ -0,0 +1,143 @@
+#ifndef WR_TEMPERING_H
+#define WR_TEMPERING_H
+
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bookkeeping for parallel tempering over a fugacity grid z_0 < z_1 < ... < z_{n-1}.
+//
+// The grand-canonical weight of a configuration with N particles is z^N, so swapping the
+// configurations of neighbors a, b is accepted with min(1, (z_a / z_b)^(N_b - N_a)).
+// Every configuration ("walker") carries an id; a round trip is a walker going from the
+// lowest z to the highest and back, and its duration in sweeps is the usual measure of
+// how well the tempering mixes across the transition.
+
+class TemperingStats {
+public:
+    explicit TemperingStats(std::size_t n_slots)
+        : attempts_(n_slots ? n_slots - 1 : 0, 0), accepted_(n_slots ? n_slots - 1 : 0, 0),
+          walker_(n_slots), direction_(n_slots, 0), left_bottom_(n_slots, 0) {
+        for (std::size_t i = 0; i < n_slots; i++) walker_[i] = i;
+    }
+
+    // swap between slots i and i + 1
+    void recordSwap(std::size_t i, bool accepted) {
+        attempts_[i]++;
+        if (accepted) {
+            accepted_[i]++;
+            std::swap(walker_[i], walker_[i + 1]);
+        }
+    }
+
+    // after the swaps of sweep `sweep`: walkers at the ends update their direction
+    void update(uint64_t sweep) {
+        const std::size_t n = walker_.size();
+        if (n < 2) return;
+
+        int bottom = walker_[0];
+        if (direction_[bottom] == -1) {         // came down from the top: round trip done
+            round_trips_++;
+            round_trip_sweeps_ += sweep - left_bottom_[bottom];
+        }
+        if (direction_[bottom] != 1) {
+            direction_[bottom] = 1;
+            left_bottom_[bottom] = sweep;
+        }
+
+        int top = walker_[n - 1];
+        if (direction_[top] == 1) {
+            direction_[top] = -1;
+        }
+    }
+
+    double acceptance(std::size_t i) const {
+        return attempts_[i] ? static_cast<double>(accepted_[i]) / attempts_[i] : NAN;
+    }
+
+    uint64_t roundTrips() const { return round_trips_; }
+    double meanRoundTrip() const { return round_trips_ ? static_cast<double>(round_trip_sweeps_) / round_trips_ : NAN; }
+
+    // data/sampling/tempering/tempering_<...>.json
+    void writeJson(const std::string& path, const std::vector<double>& z, uint64_t sweeps, int swap_every) const {
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent);
+        }
+
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Could not open " + path + " for writing.");
+        }
+
+        auto num = [](double v) {
+            std::ostringstream ss;
+            if (std::isfinite(v)) ss << std::setprecision(17) << v;
+            else ss << "null";
+            return ss.str();
+        };
+
+        out << "{\n";
+        out << "  \"sweeps\": " << sweeps << ",\n";
+        out << "  \"swap_every\": " << swap_every << ",\n";
+        out << "  \"z\": [";
+        for (std::size_t i = 0; i < z.size(); i++) out << (i ? ", " : "") << num(z[i]);
+        out << "],\n";
+        out << "  \"swap_attempts\": [";
+        for (std::size_t i = 0; i < attempts_.size(); i++) out << (i ? ", " : "") << attempts_[i];
+        out << "],\n";
+        out << "  \"swap_acceptance\": [";
+        for (std::size_t i = 0; i < attempts_.size(); i++) out << (i ? ", " : "") << num(acceptance(i));
+        out << "],\n";
+        out << "  \"round_trips\": " << round_trips_ << ",\n";
+        out << "  \"mean_round_trip\": " << num(meanRoundTrip()) << "\n";
+        out << "}\n";
+    }
+
+private:
+    std::vector<uint64_t> attempts_;    // per neighbor pair (i, i + 1)
+    std::vector<uint64_t> accepted_;
+    std::vector<int> walker_;           // walker id at each slot
+    std::vector<int> direction_;        // per walker: 1 = last end visited was the bottom, -1 = the top, 0 = neither yet
+    std::vector<uint64_t> left_bottom_; // per walker: sweep of its last arrival at the bottom
+    uint64_t round_trips_ = 0;
+    uint64_t round_trip_sweeps_ = 0;
+};
+
+// Reusable barrier of `count` threads: the tempering workers meet at it between the sweep phase
+// and the swap phase of every exchange interval, so they are started once per run.
+class PhaseBarrier {
+public:
+    explicit PhaseBarrier(int count) : count_(count) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const uint64_t generation = generation_;
+        if (++waiting_ == count_) {
+            waiting_ = 0;
+            generation_++;
+            released_.notify_all();
+        }
+        else {
+            released_.wait(lock, [&] { return generation_ != generation; });
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable released_;
+    const int count_;
+    int waiting_ = 0;
+    uint64_t generation_ = 0;
+};
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef WR_TIMESERIES_H
+#define WR_TIMESERIES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// Binary per-run time series: every observable of a sweep interleaved in one record,
+// buffered in memory and written in large blocks. Read back with
+// src/actions/timeseries_io.py (read_series / load_observable) or readSeriesField below.
+//
+// Layout (native little-endian):
+//   TimeSeriesHeader                        80 bytes
+//   char field_names[n_fields][16]          NUL padded
+//   records: n_fields values of float32 or float64 (value_bytes = 4 / 8)
+// n_records is patched in on close(); a run that is still going (or was killed) reads as 0,
+// in which case readers derive the count from the file size.
+
+constexpr char TIMESERIES_MAGIC[8] = {'W', 'R', 'S', 'E', 'R', 'I', 'E', 'S'};
+constexpr uint32_t TIMESERIES_VERSION = 1;
+constexpr std::size_t TIMESERIES_FIELD_BYTES = 16;
+
+struct TimeSeriesHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;      // header + field names, i.e. offset of the first record
+    int32_t L;
+    int32_t M;
+    double z;
+    char lat[16];
+    int32_t run;
+    uint32_t stride;            // sweeps between records
+    uint64_t seed;
+    uint32_t n_fields;
+    uint32_t value_bytes;
+    uint64_t n_records;
+};
+static_assert(sizeof(TimeSeriesHeader) == 80, "time series header must stay 80 bytes");
+
+// state point and provenance recorded in the header
+struct TimeSeriesInfo {
+    int L = 0;
+    int M = 0;
+    double z = 0;
+    std::string lat;
+    int run = 0;
+    uint64_t seed = 0;
+    int stride = 1;
+};
+
+class TimeSeriesWriter {
+public:
+    TimeSeriesWriter(const std::string& path, const TimeSeriesInfo& info, const std::vector<std::string>& fields,
+                     bool float64 = false, std::size_t buffer_bytes = 1 << 20)
+        : path_(path), n_fields_(fields.size()), value_bytes_(float64 ? 8 : 4) {
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent);
+        }
+
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            throw std::runtime_error("Could not open " + path + " for writing.");
+        }
+
+        header_ = TimeSeriesHeader{};
+        std::memcpy(header_.magic, TIMESERIES_MAGIC, sizeof(header_.magic));
+        header_.version = TIMESERIES_VERSION;
+        header_.header_bytes = sizeof(TimeSeriesHeader) + TIMESERIES_FIELD_BYTES * n_fields_;
+        header_.L = info.L;
+        header_.M = info.M;
+        header_.z = info.z;
+        std::strncpy(header_.lat, info.lat.c_str(), sizeof(header_.lat) - 1);
+        header_.run = info.run;
+        header_.stride = info.stride;
+        header_.seed = info.seed;
+        header_.n_fields = n_fields_;
+        header_.value_bytes = value_bytes_;
+        header_.n_records = 0;
+
+        std::vector<char> names(TIMESERIES_FIELD_BYTES * n_fields_, 0);
+        for (std::size_t f = 0; f < n_fields_; f++) {
+            std::strncpy(&names[f * TIMESERIES_FIELD_BYTES], fields[f].c_str(), TIMESERIES_FIELD_BYTES - 1);
+        }
+
+        std::fwrite(&header_, sizeof(header_), 1, file_);
+        std::fwrite(names.data(), 1, names.size(), file_);
+
+        record_bytes_ = n_fields_ * value_bytes_;
+        buffer_.reserve(std::max(buffer_bytes, record_bytes_));
+    }
+
+    // Reopens the series of an interrupted run (see checkpoint.h): keeps the first
+    // `keep_records` records, drops anything written after them and appends from there.
+    TimeSeriesWriter(const std::string& path, const TimeSeriesInfo& info, uint64_t keep_records,
+                     std::size_t buffer_bytes = 1 << 20)
+        : path_(path) {
+        file_ = std::fopen(path.c_str(), "r+b");
+        if (!file_) {
+            throw std::runtime_error("Could not reopen time series " + path);
+        }
+
+        if (std::fread(&header_, sizeof(header_), 1, file_) != 1
+            || std::memcmp(header_.magic, TIMESERIES_MAGIC, sizeof(header_.magic)) != 0
+            || header_.L != info.L || header_.M != info.M || header_.z != info.z
+            || info.lat.compare(0, sizeof(header_.lat) - 1, header_.lat) != 0
+            || header_.run != info.run || header_.seed != info.seed) {
+            std::fclose(file_);
+            file_ = nullptr;
+            throw std::runtime_error("Time series " + path + " does not belong to this run.");
+        }
+
+        n_fields_ = header_.n_fields;
+        value_bytes_ = header_.value_bytes;
+        record_bytes_ = n_fields_ * value_bytes_;
+
+        const uint64_t keep_bytes = header_.header_bytes + keep_records * record_bytes_;
+        if (std::filesystem::file_size(path) < keep_bytes) {
+            std::fclose(file_);
+            file_ = nullptr;
+            throw std::runtime_error("Time series " + path + " is shorter than its checkpoint.");
+        }
+
+        // a reopened series is "in progress" again until close()
+        header_.n_records = 0;
+        std::fseek(file_, 0, SEEK_SET);
+        std::fwrite(&header_, sizeof(header_), 1, file_);
+        std::fflush(file_);
+        std::filesystem::resize_file(path, keep_bytes);
+        std::fseek(file_, 0, SEEK_END);
+
+        n_records_ = keep_records;
+        buffer_.reserve(std::max(buffer_bytes, record_bytes_));
+    }
+
+    ~TimeSeriesWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    TimeSeriesWriter(const TimeSeriesWriter&) = delete;
+    TimeSeriesWriter& operator=(const TimeSeriesWriter&) = delete;
+
+    // one record, n_fields values in field order
+    void append(const double* values) {
+        if (buffer_.size() + record_bytes_ > buffer_.capacity()) {
+            flush();
+        }
+        for (std::size_t f = 0; f < n_fields_; f++) {
+            if (value_bytes_ == 4) {
+                float v = static_cast<float>(values[f]);
+                buffer_.insert(buffer_.end(), reinterpret_cast<const char*>(&v), reinterpret_cast<const char*>(&v) + 4);
+            } else {
+                buffer_.insert(buffer_.end(), reinterpret_cast<const char*>(&values[f]), reinterpret_cast<const char*>(&values[f]) + 8);
+            }
+        }
+        n_records_++;
+    }
+
+    void append(std::initializer_list<double> values) {
+        append(values.begin());
+    }
+
+    void flush() {
+        if (!file_ || buffer_.empty()) return;
+        if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+            throw std::runtime_error("Failed writing time series " + path_);
+        }
+        buffer_.clear();
+    }
+
+    // flush() all the way to disk, e.g. before a checkpoint refers to the records written so far
+    void sync() {
+        if (!file_) return;
+        flush();
+        if (std::fflush(file_) != 0 || fsync(fileno(file_)) != 0) {
+            throw std::runtime_error("Failed syncing time series " + path_);
+        }
+    }
+
+    // flushes and records the final record count in the header
+    void close() {
+        if (!file_) return;
+        flush();
+        header_.n_records = n_records_;
+        std::fseek(file_, 0, SEEK_SET);
+        std::fwrite(&header_, sizeof(header_), 1, file_);
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    uint64_t records() const { return n_records_; }
+
+private:
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    TimeSeriesHeader header_;
+    std::size_t n_fields_;
+    std::size_t value_bytes_;
+    std::size_t record_bytes_;
+    std::vector<char> buffer_;
+    uint64_t n_records_ = 0;
+};
+
+// One field of a series as float64, read in a single pass over the records. A run that is
+// still going (n_records = 0) yields every complete record on disk. info gets the header.
+inline std::vector<double> readSeriesField(const std::string& path, const std::string& field, TimeSeriesInfo* info = nullptr) {
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) {
+        throw std::runtime_error("Could not open time series " + path);
+    }
+
+    TimeSeriesHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, in) == 1
+              && std::memcmp(header.magic, TIMESERIES_MAGIC, sizeof(header.magic)) == 0
+              && (header.value_bytes == 4 || header.value_bytes == 8) && header.n_fields > 0;
+    std::size_t index = header.n_fields;
+    for (std::size_t f = 0; ok && f < header.n_fields; f++) {
+        char name[TIMESERIES_FIELD_BYTES + 1] = {};
+        ok = std::fread(name, 1, TIMESERIES_FIELD_BYTES, in) == TIMESERIES_FIELD_BYTES;
+        if (ok && field == name) index = f;
+    }
+    if (!ok || index == header.n_fields) {
+        std::fclose(in);
+        throw std::runtime_error(ok ? "No field " + field + " in time series " + path : "Corrupt time series: " + path);
+    }
+
+    const std::size_t record_bytes = header.n_fields * header.value_bytes;
+    uint64_t n = (std::filesystem::file_size(path) - header.header_bytes) / record_bytes;
+    if (header.n_records > 0) n = std::min<uint64_t>(n, header.n_records);
+
+    std::vector<double> values(n);
+    std::vector<char> chunk(record_bytes << 16);
+    std::fseek(in, header.header_bytes, SEEK_SET);
+    for (uint64_t r = 0; r < n;) {
+        const std::size_t m = std::min<uint64_t>(n - r, chunk.size() / record_bytes);
+        if (std::fread(chunk.data(), record_bytes, m, in) != m) {
+            std::fclose(in);
+            throw std::runtime_error("Failed reading time series " + path);
+        }
+        for (std::size_t j = 0; j < m; j++) {
+            const char* v = &chunk[j * record_bytes + index * header.value_bytes];
+            if (header.value_bytes == 4) {
+                float x;
+                std::memcpy(&x, v, 4);
+                values[r + j] = x;
+            } else {
+                std::memcpy(&values[r + j], v, 8);
+            }
+        }
+        r += m;
+    }
+    std::fclose(in);
+
+    if (info) {
+        header.lat[sizeof(header.lat) - 1] = '\0';
+        info->L = header.L;
+        info->M = header.M;
+        info->z = header.z;
+        info->lat = header.lat;
+        info->run = header.run;
+        info->seed = header.seed;
+        info->stride = header.stride;
+    }
+    return values;
+}
+
+#endif